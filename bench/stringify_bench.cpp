@@ -0,0 +1,234 @@
+// Сравнение компактной записи с прежним stringifyto, который дописывал
+// строку по токенам (push_back/append на каждый символ и число).
+//
+//   g++ -std=c++20 -O2 -I../src stringify_bench.cpp ../src/*.cpp -o stringify_bench
+//   ./stringify_bench [file.json]
+//
+// Без файла документ строится из 20000 записей с числами, строками и
+// вложенными массивами. Перед замерами проверяется, что обе записи совпадают.
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+
+#include "value.h"
+
+using namespace Json;
+
+namespace
+{
+    // прежняя запись: посимвольное экранирование и дописывание по токенам
+    void legacyEscapeTo(std::string &buff, std::string_view s)
+    {
+        static const char hex[] = "0123456789abcdef";
+        for (char c : s)
+        {
+            switch (c)
+            {
+            case '\"':
+                buff.append("\\\"");
+                break;
+            case '\\':
+                buff.append("\\\\");
+                break;
+            case '\b':
+                buff.append("\\b");
+                break;
+            case '\f':
+                buff.append("\\f");
+                break;
+            case '\n':
+                buff.append("\\n");
+                break;
+            case '\r':
+                buff.append("\\r");
+                break;
+            case '\t':
+                buff.append("\\t");
+                break;
+            default:
+                if ((unsigned char)c < 0x20)
+                {
+                    buff.append("\\u00");
+                    buff.push_back(hex[(unsigned char)c >> 4]);
+                    buff.push_back(hex[c & 0xf]);
+                }
+                else
+                {
+                    buff.push_back(c);
+                }
+                break;
+            }
+        }
+    }
+
+    std::string &legacyStringifyTo(std::string &buff, const Value &v)
+    {
+        switch (v.type())
+        {
+        case Value::Type::UNDEFINED:
+            buff.append("null");
+            break;
+
+        case Value::Type::INTEGER:
+            numberto(buff, v.asLongLong());
+            break;
+
+        case Value::Type::NUMBER:
+            numberto(buff, v.asNumber());
+            break;
+
+        case Value::Type::BOOLEAN:
+            buff.append(v.asBoolean() ? "true" : "false");
+            break;
+
+        case Value::Type::STRING:
+            buff.push_back('\"');
+            legacyEscapeTo(buff, v.asStringView());
+            buff.push_back('\"');
+            break;
+
+        case Value::Type::ARRAY:
+        {
+            buff.push_back('[');
+            for (size_t i = 0, n = v.size(); i < n; ++i)
+            {
+                if (i)
+                    buff.push_back(',');
+                legacyStringifyTo(buff, v[i]);
+            }
+            buff.push_back(']');
+        }
+        break;
+
+        case Value::Type::OBJECT:
+        {
+            buff.push_back('{');
+            int i = 0;
+            for (const auto &p : *v.asObject())
+            {
+                if (i++)
+                    buff.push_back(',');
+                buff.push_back('\"');
+                legacyEscapeTo(buff, p.first.view());
+                buff.push_back('\"');
+                buff.push_back(':');
+                legacyStringifyTo(buff, p.second);
+            }
+            buff.push_back('}');
+        }
+        break;
+
+        default:
+            break;
+        }
+        return buff;
+    }
+
+    std::string payload()
+    {
+        std::mt19937 rng(42);
+        std::uniform_real_distribution<double> real(-1000, 1000);
+        std::uniform_int_distribution<int> small(-1000, 1000);
+        // записи в JSON, две последние с экранированием
+        static const char *tags[] = {"\"alpha\"", "\"beta\"", "\"gamma\"", "\"line\\nbreak\"", "\"quote\\\"d\""};
+
+        std::string s = "[";
+        for (int i = 0; i < 20000; ++i)
+        {
+            if (i)
+                s += ',';
+            s += "{\"id\":" + std::to_string(i) +
+                 ",\"name\":\"user" + std::to_string(i) +
+                 "\",\"email\":\"user" + std::to_string(i) + "@example.com\"" +
+                 ",\"score\":" + std::to_string(real(rng)) +
+                 ",\"active\":" + (i % 3 ? "true" : "false") +
+                 ",\"tags\":[";
+            for (int t = 0, n = i % 4; t < n; ++t)
+                s += (t ? "," : "") + std::string(tags[(i + t) % 5]);
+            s += "],\"pos\":[" + std::to_string(small(rng)) + "," + std::to_string(small(rng)) + "," +
+                 std::to_string(small(rng)) + "],\"samples\":[";
+            for (int k = 0; k < 16; ++k)
+                s += (k ? "," : "") + std::to_string(real(rng));
+            s += "],\"note\":null}";
+        }
+        s += "]";
+        return s;
+    }
+
+    template <class F>
+    void run(const char *name, F fn)
+    {
+        double best = 1e9;
+        size_t size = 0;
+        for (int r = 0; r < 31; ++r)
+        {
+            auto t0 = std::chrono::steady_clock::now();
+            size = fn();
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+            if (ms < best)
+                best = ms;
+        }
+        printf("%-28s %9.2f ms %10zu bytes\n", name, best, size);
+    }
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    std::string text;
+    if (argc > 1)
+    {
+        std::ifstream f(argv[1], std::ios::binary);
+        std::stringstream ss;
+        ss << f.rdbuf();
+        text = ss.str();
+    }
+    else
+    {
+        text = payload();
+    }
+
+    const Value v = parseJson(text.data(), text.data() + text.size());
+    if (v.isUndefined())
+    {
+        fprintf(stderr, "parse failed\n");
+        return 1;
+    }
+
+    std::string legacy, current;
+    legacyStringifyTo(legacy, v);
+    stringifyto(current, v);
+    if (legacy != current)
+    {
+        fprintf(stderr, "output differs from the legacy writer\n");
+        return 1;
+    }
+
+    run("legacy stringifyto", [&] { std::string b; return legacyStringifyTo(b, v).size(); });
+    run("stringifyto", [&] { std::string b; return stringifyto(b, v).size(); });
+    run("stringifyto, reused buffer", [&] { static std::string b; b.clear(); return stringifyto(b, v).size(); });
+    run("stringify sorted", [&] { return stringify(v, true).size(); });
+    run("legacy, per element", [&] {
+        size_t n = 0;
+        for (size_t i = 0; i < v.size(); ++i)
+        {
+            std::string b;
+            n += legacyStringifyTo(b, v[i]).size();
+        }
+        return n;
+    });
+    run("stringifyto, per element", [&] {
+        size_t n = 0;
+        for (size_t i = 0; i < v.size(); ++i)
+        {
+            std::string b;
+            n += stringifyto(b, v[i]).size();
+        }
+        return n;
+    });
+    return 0;
+}
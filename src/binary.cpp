@@ -0,0 +1,316 @@
+#include "binary.h"
+#include "streamwriter.h"
+#include "valuebuilder.h"
+
+namespace Json
+{
+    namespace
+    {
+        // запись в конец строки
+        struct StringOut
+        {
+            std::string &buff;
+
+            void put(const char *s, size_t n) { buff.append(s, n); }
+        };
+
+        struct StreamOut
+        {
+            StreamWriter &writer;
+
+            void put(const char *s, size_t n) { writer.writeRaw(std::string_view(s, n)); }
+        };
+
+        char *storeBigEndian(char *p, uint64_t v, size_t size)
+        {
+            for (size_t i = size; i--;)
+            {
+                p[i] = (char)(v & 0xff);
+                v >>= 8;
+            }
+            return p + size;
+        }
+
+        // общий обход Value; Format пишет заголовки и скаляры
+        template <class Format, class Out>
+        class Encoder
+        {
+        public:
+            explicit Encoder(Out &out)
+                : _out(out)
+            {
+            }
+
+            void value(const Value &v)
+            {
+                switch (v.type())
+                {
+                case Value::Type::UNDEFINED:
+                    byte(Format::NIL);
+                    break;
+
+                case Value::Type::BOOLEAN:
+                    byte(v.asBoolean() ? Format::BOOL_TRUE : Format::BOOL_FALSE);
+                    break;
+
+                case Value::Type::INTEGER:
+                    integer(v.asLongLong());
+                    break;
+
+                case Value::Type::NUMBER:
+                    number(v.asNumber());
+                    break;
+
+                case Value::Type::STRING:
+                    string(v.asStringView());
+                    break;
+
+                case Value::Type::ARRAY:
+                {
+                    size_t n = v.size();
+                    head(Format::array(_head, n));
+
+                    // упакованные массивы пишутся без распаковки
+                    if (const double *pn = v.packedNumbers())
+                    {
+                        for (size_t i = 0; i < n; ++i)
+                            number(pn[i]);
+                    }
+                    else if (const int64_t *pi = v.packedIntegers())
+                    {
+                        for (size_t i = 0; i < n; ++i)
+                            integer((long long)pi[i]);
+                    }
+                    else
+                    {
+                        for (const Value &item : *v.asArray())
+                            value(item);
+                    }
+                    break;
+                }
+
+                case Value::Type::OBJECT:
+                {
+                    const ObjectContainer &o = *v.asObject();
+                    head(Format::map(_head, o.size()));
+                    for (const auto &p : o)
+                    {
+                        string(p.first.view());
+                        value(p.second);
+                    }
+                    break;
+                }
+
+                default:
+                    break;
+                }
+            }
+
+        private:
+            void byte(unsigned char c)
+            {
+                char s = (char)c;
+                _out.put(&s, 1);
+            }
+
+            void head(char *end) { _out.put(_head, end - _head); }
+
+            void integer(long long v) { head(Format::integer(_head, v)); }
+
+            void number(double v)
+            {
+                uint64_t w;
+                memcpy(&w, &v, sizeof(w));
+                _head[0] = (char)Format::FLOAT64;
+                head(storeBigEndian(_head + 1, w, 8));
+            }
+
+            void string(std::string_view s)
+            {
+                head(Format::string(_head, s.size()));
+                _out.put(s.data(), s.size());
+            }
+
+            Out &_out;
+            char _head[9]; // тип и до 8 байт длины или значения
+        };
+
+        struct Msgpack
+        {
+            static constexpr unsigned char NIL = 0xc0;
+            static constexpr unsigned char BOOL_FALSE = 0xc2;
+            static constexpr unsigned char BOOL_TRUE = 0xc3;
+            static constexpr unsigned char FLOAT64 = 0xcb;
+
+            static char *head(char *p, unsigned char c, uint64_t v, size_t size)
+            {
+                *p = (char)c;
+                return storeBigEndian(p + 1, v, size);
+            }
+
+            static char *integer(char *p, long long v)
+            {
+                if (v >= 0)
+                {
+                    if (v < 0x80)
+                        return head(p, (unsigned char)v, 0, 0);
+                    if (v <= 0xff)
+                        return head(p, 0xcc, v, 1);
+                    if (v <= 0xffff)
+                        return head(p, 0xcd, v, 2);
+                    if (v <= 0xffffffff)
+                        return head(p, 0xce, v, 4);
+                    return head(p, 0xcf, v, 8);
+                }
+
+                if (v >= -32)
+                    return head(p, (unsigned char)v, 0, 0);
+                if (v >= INT8_MIN)
+                    return head(p, 0xd0, (uint64_t)v, 1);
+                if (v >= INT16_MIN)
+                    return head(p, 0xd1, (uint64_t)v, 2);
+                if (v >= INT32_MIN)
+                    return head(p, 0xd2, (uint64_t)v, 4);
+                return head(p, 0xd3, (uint64_t)v, 8);
+            }
+
+            static char *string(char *p, size_t n)
+            {
+                if (n < 32)
+                    return head(p, (unsigned char)(0xa0 | n), 0, 0);
+                if (n <= 0xff)
+                    return head(p, 0xd9, n, 1);
+                if (n <= 0xffff)
+                    return head(p, 0xda, n, 2);
+                return head(p, 0xdb, n, 4);
+            }
+
+            static char *array(char *p, size_t n)
+            {
+                if (n < 16)
+                    return head(p, (unsigned char)(0x90 | n), 0, 0);
+                if (n <= 0xffff)
+                    return head(p, 0xdc, n, 2);
+                return head(p, 0xdd, n, 4);
+            }
+
+            static char *map(char *p, size_t n)
+            {
+                if (n < 16)
+                    return head(p, (unsigned char)(0x80 | n), 0, 0);
+                if (n <= 0xffff)
+                    return head(p, 0xde, n, 2);
+                return head(p, 0xdf, n, 4);
+            }
+        };
+
+        struct Cbor
+        {
+            static constexpr unsigned char NIL = 0xf6;
+            static constexpr unsigned char BOOL_FALSE = 0xf4;
+            static constexpr unsigned char BOOL_TRUE = 0xf5;
+            static constexpr unsigned char FLOAT64 = 0xfb;
+
+            // старший тип и аргумент в самой короткой записи
+            static char *head(char *p, unsigned major, uint64_t v)
+            {
+                unsigned char c = (unsigned char)(major << 5);
+                if (v < 24)
+                {
+                    *p = (char)(c | v);
+                    return p + 1;
+                }
+
+                unsigned info = v <= 0xff ? 24 : v <= 0xffff ? 25 : v <= 0xffffffff ? 26 : 27;
+                *p = (char)(c | info);
+                return storeBigEndian(p + 1, v, (size_t)1 << (info - 24));
+            }
+
+            static char *integer(char *p, long long v)
+            {
+                return v >= 0 ? head(p, 0, (uint64_t)v) : head(p, 1, (uint64_t)(-1 - v));
+            }
+
+            static char *string(char *p, size_t n) { return head(p, 3, n); }
+            static char *array(char *p, size_t n) { return head(p, 4, n); }
+            static char *map(char *p, size_t n) { return head(p, 5, n); }
+        };
+
+        template <template <class> class Reader>
+        Value parseBinary(const char *data, const char *end, ValueBuilder &builder)
+        {
+            Reader<ValueBuilder> reader(builder);
+            if (!reader.parse(data, end) || !builder.done())
+                return Value();
+            return builder.release();
+        }
+
+    } // namespace
+
+    std::string &msgpackto(std::string &buff, const Value &v)
+    {
+        StringOut out{buff};
+        Encoder<Msgpack, StringOut>(out).value(v);
+        return buff;
+    }
+
+    std::string &cborto(std::string &buff, const Value &v)
+    {
+        StringOut out{buff};
+        Encoder<Cbor, StringOut>(out).value(v);
+        return buff;
+    }
+
+    std::string toMsgpack(const Value &v)
+    {
+        std::string res;
+        msgpackto(res, v);
+        return res;
+    }
+
+    std::string toCbor(const Value &v)
+    {
+        std::string res;
+        cborto(res, v);
+        return res;
+    }
+
+    bool writeMsgpack(StreamWriter &writer, const Value &v)
+    {
+        StreamOut out{writer};
+        Encoder<Msgpack, StreamOut>(out).value(v);
+        return writer.ok();
+    }
+
+    bool writeCbor(StreamWriter &writer, const Value &v)
+    {
+        StreamOut out{writer};
+        Encoder<Cbor, StreamOut>(out).value(v);
+        return writer.ok();
+    }
+
+    Json::Value parseMsgpack(const char *data, const char *end, std::pmr::memory_resource *r)
+    {
+        ValueBuilder builder(nullptr, r);
+        return parseBinary<MsgpackReader>(data, end, builder);
+    }
+
+    Json::Value parseMsgpack(const char *data, const char *end, Document *doc)
+    {
+        ValueBuilder builder(doc);
+        return parseBinary<MsgpackReader>(data, end, builder);
+    }
+
+    Json::Value parseCbor(const char *data, const char *end, std::pmr::memory_resource *r)
+    {
+        ValueBuilder builder(nullptr, r);
+        return parseBinary<CborReader>(data, end, builder);
+    }
+
+    Json::Value parseCbor(const char *data, const char *end, Document *doc)
+    {
+        ValueBuilder builder(doc);
+        return parseBinary<CborReader>(data, end, builder);
+    }
+
+} // namespace Json
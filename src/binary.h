@@ -0,0 +1,544 @@
+#ifndef BINARY_H
+#define BINARY_H
+
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+
+#include "value.h"
+
+namespace Json
+{
+    class StreamWriter;
+
+    /* Двоичные форматы MessagePack и CBOR (RFC 8949).
+
+       Запись:
+           UNDEFINED    nil / null
+           BOOLEAN      false, true
+           INTEGER      целое самой короткой записи, int64 без потерь
+           NUMBER       float64, double без потерь
+           STRING       str / текстовая строка, байты как есть
+           ARRAY        array
+           OBJECT       map со строковыми ключами
+       Чтение принимает и прочие записи тех же типов: float32 (и float16 в
+       CBOR), bin и байтовые строки (как STRING), целые ключи map (как
+       десятичная строка), в CBOR — строки, массивы и map неопределённой
+       длины, теги (пропускаются) и undefined (как null). Целые больше
+       int64 читаются как double, как в parseJson; бесконечность и NaN, как
+       и в Value(double), дают undefined. ext MessagePack и прочие простые
+       значения CBOR — ошибка. Вложенность массивов, map и тегов CBOR
+       ограничена BinaryReader::maxDepth, более глубокое значение — тоже
+       ошибка */
+
+    /* дописывают v в конец buff */
+    std::string &msgpackto(std::string &buff, const Value &v);
+    std::string &cborto(std::string &buff, const Value &v);
+
+    std::string toMsgpack(const Value &v);
+    std::string toCbor(const Value &v);
+
+    /* пишут v через буфер StreamWriter в дескриптор, FILE *, ostream или
+       callback; память не зависит от размера значения */
+    bool writeMsgpack(StreamWriter &writer, const Value &v);
+    bool writeCbor(StreamWriter &writer, const Value &v);
+
+    /* первое значение из data..end в виде дерева Value, узлы и строки
+       выделяются из r. При ошибке формата или обрыве входа — undefined */
+    Json::Value parseMsgpack(const char *data, const char *end,
+                             std::pmr::memory_resource *r = std::pmr::get_default_resource());
+    Json::Value parseCbor(const char *data, const char *end,
+                          std::pmr::memory_resource *r = std::pmr::get_default_resource());
+
+    /* то же в арене документа, см. Document::parseMsgpack */
+    Json::Value parseMsgpack(const char *data, const char *end, Document *doc);
+    Json::Value parseCbor(const char *data, const char *end, Document *doc);
+
+    ////////////////////////////////////////////////////////////////////////////////
+    //
+    //  MsgpackReader, CborReader
+    //
+    //  Разбор одного значения с вызовом методов обработчика — тех же, что у
+    //  SaxReader, поэтому дерево собирает ValueBuilder. Строки передаются
+    //  без копирования и указывают во входной буфер; исключение — целые
+    //  ключи и строки CBOR неопределённой длины, они собираются в буфере
+    //  разборщика. s действительна до следующего события.
+    //
+    //  Длины контейнеров заранее не резервируются, так что ложная длина
+    //  во входе не выделяет память. Значение, оборванное концом входа,
+    //  отличается от ошибки формата по incomplete(): при чтении потока
+    //  сообщений разбор повторяется с того же места, когда придут данные:
+    //      MsgpackReader<ValueBuilder> reader(builder);
+    //      const char *p = buff.data();
+    //      while (reader.parse(p, buff.data() + buff.size()))
+    //          handle(builder.release());
+    //      if (reader.incomplete())
+    //          builder.reset(), buff.erase(0, p - buff.data());  // ждём данных
+    //
+    inline uint64_t loadBigEndian(const char *p, size_t size)
+    {
+        uint64_t v = 0;
+        for (size_t i = 0; i < size; ++i)
+            v = v << 8 | (unsigned char)p[i];
+        return v;
+    }
+
+    inline double loadFloat(const char *p)
+    {
+        uint32_t w = (uint32_t)loadBigEndian(p, 4);
+        float f;
+        memcpy(&f, &w, sizeof(f));
+        return f;
+    }
+
+    inline double loadDouble(const char *p)
+    {
+        uint64_t w = loadBigEndian(p, 8);
+        double d;
+        memcpy(&d, &w, sizeof(d));
+        return d;
+    }
+
+    /* общая часть разборщиков: проверка длины входа и скаляры */
+    template <class Handler>
+    class BinaryReader
+    {
+    public:
+        /* наибольшая вложенность: разбор рекурсивный, и без предела
+           вход из одних заголовков массивов переполнил бы стек */
+        static constexpr size_t maxDepth = 512;
+
+        /* разбор остановился на конце входа: значение пришло не целиком */
+        bool incomplete() const { return _incomplete; }
+
+    protected:
+        explicit BinaryReader(Handler &handler)
+            : _handler(handler), _incomplete(false), _depth(0)
+        {
+        }
+
+        void start()
+        {
+            _incomplete = false;
+            _depth = 0;
+        }
+
+        // вход во вложенное значение; false — слишком глубоко
+        bool enter()
+        {
+            if (_depth == maxDepth)
+                return false;
+            ++_depth;
+            return true;
+        }
+
+        void leave() { --_depth; }
+
+        // во входе осталось не меньше size байт
+        bool need(const char *data, const char *end, uint64_t size)
+        {
+            if ((uint64_t)(end - data) >= size)
+                return true;
+            _incomplete = true;
+            return false;
+        }
+
+        bool integer(long long v, bool key)
+        {
+            if (!key)
+                return _handler.onInt(v);
+
+            char s[24];
+            char *e = std::to_chars(s, s + sizeof(s), v).ptr;
+            return _handler.onKey(std::string_view(s, e - s));
+        }
+
+        bool unsignedInteger(uint64_t v, bool key)
+        {
+            if (v <= (uint64_t)INT64_MAX)
+                return integer((long long)v, key);
+            if (!key)
+                return _handler.onDouble((double)v);
+
+            char s[24];
+            char *e = std::to_chars(s, s + sizeof(s), v).ptr;
+            return _handler.onKey(std::string_view(s, e - s));
+        }
+
+        // ключом может быть только строка или целое
+        bool number(double v, bool key)
+        {
+            return !key && _handler.onDouble(v);
+        }
+
+        bool string(std::string_view s, bool key)
+        {
+            return key ? _handler.onKey(s) : _handler.onString(s);
+        }
+
+        Handler &_handler;
+        bool _incomplete;
+        size_t _depth;
+        std::string _buffer; // строка CBOR неопределённой длины
+    };
+
+    template <class Handler>
+    class MsgpackReader : public BinaryReader<Handler>
+    {
+    public:
+        explicit MsgpackReader(Handler &handler)
+            : BinaryReader<Handler>(handler)
+        {
+        }
+
+        /* разбирает первое значение из data..end; data сдвигается за него.
+           false — ошибка формата, обрыв входа или прерывание обработчиком */
+        bool parse(const char *&data, const char *end)
+        {
+            this->start();
+            return value(data, end, false);
+        }
+
+    private:
+        // значение длиной size байт после заголовка
+        bool bytes(const char *&data, const char *end, uint64_t size, uint64_t &v)
+        {
+            if (!this->need(data, end, size))
+                return false;
+            v = loadBigEndian(data, (size_t)size);
+            data += size;
+            return true;
+        }
+
+        bool value(const char *&data, const char *end, bool key)
+        {
+            if (!this->need(data, end, 1))
+                return false;
+
+            unsigned char c = (unsigned char)*data++;
+            if (c <= 0x7f)
+                return this->integer(c, key);
+            if (c >= 0xe0)
+                return this->integer((signed char)c, key);
+            if (c <= 0x8f)
+                return map(data, end, c & 0x0f, key);
+            if (c <= 0x9f)
+                return array(data, end, c & 0x0f, key);
+            if (c <= 0xbf)
+                return string(data, end, c & 0x1f, key);
+
+            uint64_t n;
+            switch (c)
+            {
+            case 0xc0:
+                return !key && this->_handler.onNull();
+            case 0xc2:
+                return !key && this->_handler.onBool(false);
+            case 0xc3:
+                return !key && this->_handler.onBool(true);
+
+            case 0xc4: // bin 8, 16, 32
+            case 0xd9: // str 8, 16, 32
+                return bytes(data, end, 1, n) && string(data, end, n, key);
+            case 0xc5:
+            case 0xda:
+                return bytes(data, end, 2, n) && string(data, end, n, key);
+            case 0xc6:
+            case 0xdb:
+                return bytes(data, end, 4, n) && string(data, end, n, key);
+
+            case 0xca:
+                if (!this->need(data, end, 4))
+                    return false;
+                data += 4;
+                return this->number(loadFloat(data - 4), key);
+            case 0xcb:
+                if (!this->need(data, end, 8))
+                    return false;
+                data += 8;
+                return this->number(loadDouble(data - 8), key);
+
+            case 0xcc:
+                return bytes(data, end, 1, n) && this->integer((long long)n, key);
+            case 0xcd:
+                return bytes(data, end, 2, n) && this->integer((long long)n, key);
+            case 0xce:
+                return bytes(data, end, 4, n) && this->integer((long long)n, key);
+            case 0xcf:
+                return bytes(data, end, 8, n) && this->unsignedInteger(n, key);
+
+            case 0xd0:
+                return bytes(data, end, 1, n) && this->integer((int8_t)n, key);
+            case 0xd1:
+                return bytes(data, end, 2, n) && this->integer((int16_t)n, key);
+            case 0xd2:
+                return bytes(data, end, 4, n) && this->integer((int32_t)n, key);
+            case 0xd3:
+                return bytes(data, end, 8, n) && this->integer((long long)(int64_t)n, key);
+
+            case 0xdc:
+                return bytes(data, end, 2, n) && array(data, end, n, key);
+            case 0xdd:
+                return bytes(data, end, 4, n) && array(data, end, n, key);
+            case 0xde:
+                return bytes(data, end, 2, n) && map(data, end, n, key);
+            case 0xdf:
+                return bytes(data, end, 4, n) && map(data, end, n, key);
+
+            default: // 0xc1 и ext
+                return false;
+            }
+        }
+
+        bool string(const char *&data, const char *end, uint64_t size, bool key)
+        {
+            if (!this->need(data, end, size))
+                return false;
+            data += size;
+            return BinaryReader<Handler>::string(std::string_view(data - size, (size_t)size), key);
+        }
+
+        bool array(const char *&data, const char *end, uint64_t size, bool key)
+        {
+            if (key || !this->enter() || !this->_handler.onStartArray())
+                return false;
+            for (uint64_t i = 0; i < size; ++i)
+            {
+                if (!value(data, end, false))
+                    return false;
+            }
+            this->leave();
+            return this->_handler.onEndArray();
+        }
+
+        bool map(const char *&data, const char *end, uint64_t size, bool key)
+        {
+            if (key || !this->enter() || !this->_handler.onStartObject())
+                return false;
+            for (uint64_t i = 0; i < size; ++i)
+            {
+                if (!value(data, end, true) || !value(data, end, false))
+                    return false;
+            }
+            this->leave();
+            return this->_handler.onEndObject();
+        }
+    };
+
+    template <class Handler>
+    class CborReader : public BinaryReader<Handler>
+    {
+    public:
+        explicit CborReader(Handler &handler)
+            : BinaryReader<Handler>(handler)
+        {
+        }
+
+        /* разбирает первое значение из data..end; data сдвигается за него.
+           false — ошибка формата, обрыв входа или прерывание обработчиком */
+        bool parse(const char *&data, const char *end)
+        {
+            this->start();
+            return value(data, end, false);
+        }
+
+    private:
+        static constexpr unsigned char BREAK = 0xff;
+
+        static constexpr unsigned INDEFINITE = 31;
+
+        // аргумент заголовка; неопределённая длина (31) разбирается отдельно
+        bool argument(const char *&data, const char *end, unsigned info, uint64_t &v)
+        {
+            if (info < 24)
+            {
+                v = info;
+                return true;
+            }
+            if (info > 27)
+                return false;
+
+            size_t size = (size_t)1 << (info - 24);
+            if (!this->need(data, end, size))
+                return false;
+            v = loadBigEndian(data, size);
+            data += size;
+            return true;
+        }
+
+        // на конце контейнера неопределённой длины
+        bool atBreak(const char *&data, const char *end, bool &done)
+        {
+            if (!this->need(data, end, 1))
+                return false;
+            done = (unsigned char)*data == BREAK;
+            if (done)
+                ++data;
+            return true;
+        }
+
+        bool value(const char *&data, const char *end, bool key)
+        {
+            if (!this->need(data, end, 1))
+                return false;
+
+            unsigned char c = (unsigned char)*data++;
+            unsigned major = c >> 5, info = c & 31;
+            if (major == 7)
+                return simple(data, end, info, key);
+
+            uint64_t n = 0;
+            bool indefinite = info == INDEFINITE;
+            if (!indefinite && !argument(data, end, info, n))
+                return false;
+
+            switch (major)
+            {
+            case 0:
+                return !indefinite && this->unsignedInteger(n, key);
+            case 1:
+                // -1 - n
+                if (indefinite)
+                    return false;
+                if (n <= (uint64_t)INT64_MAX)
+                    return this->integer(-1 - (long long)n, key);
+                if (key)
+                    return false;
+                return this->_handler.onDouble(-1.0 - (double)n);
+            case 2:
+            case 3:
+                return string(data, end, major, n, indefinite, key);
+            case 4:
+                return array(data, end, n, indefinite, key);
+            case 5:
+                return map(data, end, n, indefinite, key);
+            default: // тег: значение читается как есть
+                if (indefinite || !this->enter() || !value(data, end, key))
+                    return false;
+                this->leave();
+                return true;
+            }
+        }
+
+        bool simple(const char *&data, const char *end, unsigned info, bool key)
+        {
+            switch (info)
+            {
+            case 20:
+                return !key && this->_handler.onBool(false);
+            case 21:
+                return !key && this->_handler.onBool(true);
+            case 22: // null
+            case 23: // undefined
+                return !key && this->_handler.onNull();
+
+            case 25:
+            {
+                if (!this->need(data, end, 2))
+                    return false;
+                unsigned h = (unsigned)loadBigEndian(data, 2);
+                data += 2;
+                unsigned exp = (h >> 10) & 0x1f, mant = h & 0x3ff;
+                double v = exp == 0    ? std::ldexp(mant, -24)
+                           : exp != 31 ? std::ldexp(mant + 1024, exp - 25)
+                           : mant == 0 ? INFINITY
+                                       : NAN;
+                return this->number(h & 0x8000 ? -v : v, key);
+            }
+            case 26:
+                if (!this->need(data, end, 4))
+                    return false;
+                data += 4;
+                return this->number(loadFloat(data - 4), key);
+            case 27:
+                if (!this->need(data, end, 8))
+                    return false;
+                data += 8;
+                return this->number(loadDouble(data - 8), key);
+
+            default:
+                return false;
+            }
+        }
+
+        bool string(const char *&data, const char *end, unsigned major, uint64_t size, bool indefinite,
+                    bool key)
+        {
+            if (!indefinite)
+            {
+                if (!this->need(data, end, size))
+                    return false;
+                data += size;
+                return BinaryReader<Handler>::string(std::string_view(data - size, (size_t)size), key);
+            }
+
+            // куски определённой длины того же типа до BREAK
+            this->_buffer.clear();
+            for (;;)
+            {
+                bool done;
+                if (!atBreak(data, end, done))
+                    return false;
+                if (done)
+                    return BinaryReader<Handler>::string(this->_buffer, key);
+
+                unsigned char c = (unsigned char)*data++;
+                uint64_t n;
+                if ((unsigned)(c >> 5) != major || !argument(data, end, c & 31, n) ||
+                    !this->need(data, end, n))
+                    return false;
+                this->_buffer.append(data, (size_t)n);
+                data += n;
+            }
+        }
+
+        bool array(const char *&data, const char *end, uint64_t size, bool indefinite, bool key)
+        {
+            if (key || !this->enter() || !this->_handler.onStartArray())
+                return false;
+            for (uint64_t i = 0; indefinite || i < size; ++i)
+            {
+                if (indefinite)
+                {
+                    bool done;
+                    if (!atBreak(data, end, done))
+                        return false;
+                    if (done)
+                        break;
+                }
+                if (!value(data, end, false))
+                    return false;
+            }
+            this->leave();
+            return this->_handler.onEndArray();
+        }
+
+        bool map(const char *&data, const char *end, uint64_t size, bool indefinite, bool key)
+        {
+            if (key || !this->enter() || !this->_handler.onStartObject())
+                return false;
+            for (uint64_t i = 0; indefinite || i < size; ++i)
+            {
+                if (indefinite)
+                {
+                    bool done;
+                    if (!atBreak(data, end, done))
+                        return false;
+                    if (done)
+                        break;
+                }
+                if (!value(data, end, true) || !value(data, end, false))
+                    return false;
+            }
+            this->leave();
+            return this->_handler.onEndObject();
+        }
+    };
+
+} // namespace Json
+
+#endif // BINARY_H
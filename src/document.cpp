@@ -0,0 +1,117 @@
+#include <cstring>
+#include <functional>
+#include <new>
+
+#include "binary.h"
+#include "document.h"
+#include "parser.h"
+
+namespace Json
+{
+    Document::Document(size_t chunkSize)
+        : _arena(chunkSize), _root(nullptr), _walk(false), _input(nullptr), _inputEnd(nullptr)
+    {
+        _root = new (_arena.allocate(sizeof(Value), alignof(Value))) Value;
+    }
+
+    Document::~Document()
+    {
+        release();
+    }
+
+    void Document::release()
+    {
+        if (_walk)
+            _root->~Value();
+        _root = nullptr;
+        _arena.release();
+        _file.close();
+    }
+
+    const Value &Document::build(const char *data, const char *end, bool referenceInput, Parser parser)
+    {
+        _walk = false;
+
+        if (referenceInput)
+        {
+            _input = data;
+            _inputEnd = end;
+        }
+        _root = new (_arena.allocate(sizeof(Value), alignof(Value))) Value(parser(data, end, this));
+        _input = _inputEnd = nullptr;
+
+        return *_root;
+    }
+
+    const Value &Document::parse(const char *data, const char *end, bool referenceInput)
+    {
+        release();
+        return build(data, end, referenceInput, &parseJson);
+    }
+
+    const Value &Document::parse(const char *data, bool referenceInput)
+    {
+        return parse(data, data + strlen(data), referenceInput);
+    }
+
+    const Value &Document::parseMsgpack(const char *data, const char *end, bool referenceInput)
+    {
+        release();
+        return build(data, end, referenceInput, &Json::parseMsgpack);
+    }
+
+    const Value &Document::parseCbor(const char *data, const char *end, bool referenceInput)
+    {
+        release();
+        return build(data, end, referenceInput, &Json::parseCbor);
+    }
+
+    bool Document::parseFile(const char *fileName)
+    {
+        release();
+        _error.clear();
+
+        if (!_file.open(fileName, _error))
+        {
+            build(nullptr, nullptr, false, &parseJson);
+            return false;
+        }
+
+        build(_file.data(), _file.end(), true, &parseJson);
+        return true;
+    }
+
+    Value &Document::mutableRoot()
+    {
+        _walk = true;
+        return *_root;
+    }
+
+    Value Document::createArray()
+    {
+        return Value::createArray(&_arena);
+    }
+
+    Value Document::createObject()
+    {
+        return Value::createObject(&_arena);
+    }
+
+    Value Document::createString(std::string_view s)
+    {
+        if (s.size() > UINT32_MAX)
+        {
+            _walk = true;
+            return Value(std::string(s));
+        }
+
+        std::less_equal<const char *> le;
+        if (le(_input, s.data()) && le(s.data() + s.size(), _inputEnd))
+            return Value::view(s.data(), s.size());
+
+        char *p = (char *)_arena.allocate(s.size() ? s.size() : 1, 1);
+        memcpy(p, s.data(), s.size());
+        return Value::view(p, s.size());
+    }
+
+} // namespace Json
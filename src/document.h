@@ -0,0 +1,77 @@
+#ifndef DOCUMENT_H
+#define DOCUMENT_H
+
+#include <memory_resource>
+
+#include "mappedfile.h"
+#include "value.h"
+
+namespace Json
+{
+    /* Результат разбора, размещённый в монотонной арене документа: контейнеры,
+       ключи и строки выделяются из неё. При разрушении документа арена
+       освобождается целиком, дерево не обходится.
+       Значения документа ссылаются на арену и не должны его переживать;
+       копии значений (Value(const Value &)) от документа не зависят.
+       При referenceInput строки без escape-последовательностей не копируются,
+       а указывают во входной буфер: он должен жить дольше документа. */
+    class Document
+    {
+    public:
+        explicit Document(size_t chunkSize = 64 * 1024);
+        ~Document();
+
+        Document(const Document &) = delete;
+        Document &operator=(const Document &) = delete;
+
+        /* разбирает data..end, предыдущее дерево освобождается */
+        const Value &parse(const char *data, const char *end, bool referenceInput = false);
+        const Value &parse(const char *data, bool referenceInput = false);
+
+        /* разбирают MessagePack или CBOR (см. binary.h); при referenceInput
+           все строки указывают во входной буфер, кроме строк CBOR
+           неопределённой длины и целых ключей */
+        const Value &parseMsgpack(const char *data, const char *end, bool referenceInput = false);
+        const Value &parseCbor(const char *data, const char *end, bool referenceInput = false);
+
+        /* отображает файл в память и разбирает его; отображение живёт вместе
+           с документом, строки без escape-последовательностей указывают в него.
+           При ошибке возвращает false, описание — в error() */
+        bool parseFile(const char *fileName);
+        const std::string &error() const { return _error; }
+
+        const Value &root() const { return *_root; }
+
+        /* дерево для изменения. В него можно записать значения не из арены,
+           поэтому такой документ при разрушении обходит дерево */
+        Value &mutableRoot();
+
+        /* создают значения в арене документа; строка, лежащая во входном
+           буфере при разборе с referenceInput, не копируется */
+        Value createArray();
+        Value createObject();
+        Value createString(std::string_view s);
+
+        std::pmr::memory_resource *resource() { return &_arena; }
+
+    private:
+        typedef Value (*Parser)(const char *data, const char *end, Document *doc);
+
+        const Value &build(const char *data, const char *end, bool referenceInput, Parser parser);
+        void release();
+
+        std::pmr::monotonic_buffer_resource _arena;
+        Value *_root;
+        bool _walk;
+
+        // входной буфер, на который можно ссылаться
+        const char *_input;
+        const char *_inputEnd;
+
+        MappedFile _file;
+        std::string _error;
+    };
+
+} // namespace Json
+
+#endif // DOCUMENT_H
@@ -0,0 +1,224 @@
+#include <cstdint>
+#include <cstring>
+
+#include "escape.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define JSON_ESCAPE_X86 1
+#include <immintrin.h>
+#endif
+
+namespace Json
+{
+    namespace
+    {
+        // сколько байт добавляет экранирование символа
+        struct EscapeTable
+        {
+            unsigned char extra[256];
+
+            constexpr EscapeTable()
+                : extra()
+            {
+                for (int c = 0; c < 0x20; ++c)
+                    extra[c] = 5; // \u00xx
+                extra[(unsigned char)'\b'] = extra[(unsigned char)'\f'] = extra[(unsigned char)'\n'] = 1;
+                extra[(unsigned char)'\r'] = extra[(unsigned char)'\t'] = 1;
+                extra[(unsigned char)'\"'] = extra[(unsigned char)'\\'] = 1;
+            }
+        };
+
+        constexpr EscapeTable escapeTable;
+
+        // строки короче блока SSE2 просматриваются по байту
+        const size_t minVectorSize = 16;
+
+        inline char *escapeChar(char *out, unsigned char c)
+        {
+            static const char hex[] = "0123456789abcdef";
+            *out++ = '\\';
+            switch (c)
+            {
+            case '\b':
+                *out++ = 'b';
+                break;
+            case '\f':
+                *out++ = 'f';
+                break;
+            case '\n':
+                *out++ = 'n';
+                break;
+            case '\r':
+                *out++ = 'r';
+                break;
+            case '\t':
+                *out++ = 't';
+                break;
+            case '\"':
+            case '\\':
+                *out++ = (char)c;
+                break;
+            default:
+                memcpy(out, "u00", 3);
+                out[3] = hex[c >> 4];
+                out[4] = hex[c & 15];
+                out += 5;
+                break;
+            }
+            return out;
+        }
+
+        inline size_t extraScalar(const char *p, size_t size)
+        {
+            size_t n = 0;
+            for (size_t i = 0; i < size; ++i)
+                n += escapeTable.extra[(unsigned char)p[i]];
+            return n;
+        }
+
+        inline char *escapeScalar(char *out, const char *p, size_t size)
+        {
+            size_t run = 0;
+            for (size_t i = 0; i < size; ++i)
+            {
+                unsigned char c = (unsigned char)p[i];
+                if (!escapeTable.extra[c])
+                    continue;
+
+                memcpy(out, p + run, i - run);
+                out = escapeChar(out + (i - run), c);
+                run = i + 1;
+            }
+            memcpy(out, p + run, size - run);
+            return out + (size - run);
+        }
+
+#ifdef JSON_ESCAPE_X86
+        // Блок целиком копируется в out, затем out сдвигается до первого
+        // символа с экранированием. Это безопасно: до конца записи остаётся
+        // не меньше байт, чем до конца строки.
+
+        __attribute__((target("sse2"))) inline uint32_t specialMask(__m128i v)
+        {
+            // '"', '\\' и x <= 0x1F без знака
+            __m128i s = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\"')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\\')));
+            s = _mm_or_si128(s, _mm_cmpeq_epi8(_mm_min_epu8(v, _mm_set1_epi8(0x1F)), v));
+            return (uint32_t)_mm_movemask_epi8(s);
+        }
+
+        __attribute__((target("avx2"))) inline uint32_t specialMask(__m256i v)
+        {
+            __m256i s = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\"')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\')));
+            s = _mm256_or_si256(s, _mm256_cmpeq_epi8(_mm256_min_epu8(v, _mm256_set1_epi8(0x1F)), v));
+            return (uint32_t)_mm256_movemask_epi8(s);
+        }
+
+        __attribute__((target("sse2"))) size_t escapedSizeSse2(const char *p, size_t size)
+        {
+            size_t n = size, i = 0;
+            for (; i + 16 <= size; i += 16)
+            {
+                for (uint32_t m = specialMask(_mm_loadu_si128((const __m128i *)(p + i))); m; m &= m - 1)
+                    n += escapeTable.extra[(unsigned char)p[i + __builtin_ctz(m)]];
+            }
+            return n + extraScalar(p + i, size - i);
+        }
+
+        __attribute__((target("sse2"))) char *escapeSse2(char *out, const char *p, size_t size)
+        {
+            size_t i = 0;
+            while (i + 16 <= size)
+            {
+                __m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+                _mm_storeu_si128((__m128i *)out, v);
+                uint32_t m = specialMask(v);
+                if (!m)
+                {
+                    out += 16;
+                    i += 16;
+                    continue;
+                }
+
+                unsigned k = __builtin_ctz(m);
+                out = escapeChar(out + k, (unsigned char)p[i + k]);
+                i += k + 1;
+            }
+            return escapeScalar(out, p + i, size - i);
+        }
+
+        __attribute__((target("avx2"))) size_t escapedSizeAvx2(const char *p, size_t size)
+        {
+            size_t n = size, i = 0;
+            for (; i + 32 <= size; i += 32)
+            {
+                for (uint32_t m = specialMask(_mm256_loadu_si256((const __m256i *)(p + i))); m; m &= m - 1)
+                    n += escapeTable.extra[(unsigned char)p[i + __builtin_ctz(m)]];
+            }
+            if (i + 16 <= size)
+            {
+                for (uint32_t m = specialMask(_mm_loadu_si128((const __m128i *)(p + i))); m; m &= m - 1)
+                    n += escapeTable.extra[(unsigned char)p[i + __builtin_ctz(m)]];
+                i += 16;
+            }
+            return n + extraScalar(p + i, size - i);
+        }
+
+        __attribute__((target("avx2"))) char *escapeAvx2(char *out, const char *p, size_t size)
+        {
+            size_t i = 0;
+            while (i + 32 <= size)
+            {
+                __m256i v = _mm256_loadu_si256((const __m256i *)(p + i));
+                _mm256_storeu_si256((__m256i *)out, v);
+                uint32_t m = specialMask(v);
+                if (!m)
+                {
+                    out += 32;
+                    i += 32;
+                    continue;
+                }
+
+                unsigned k = __builtin_ctz(m);
+                out = escapeChar(out + k, (unsigned char)p[i + k]);
+                i += k + 1;
+            }
+            return escapeSse2(out, p + i, size - i);
+        }
+#endif
+
+        struct EscapeFunctions
+        {
+            size_t (*size)(const char *, size_t);
+            char *(*escape)(char *, const char *, size_t);
+        };
+
+        EscapeFunctions selectEscapeFunctions()
+        {
+#ifdef JSON_ESCAPE_X86
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2"))
+                return EscapeFunctions{escapedSizeAvx2, escapeAvx2};
+            if (__builtin_cpu_supports("sse2"))
+                return EscapeFunctions{escapedSizeSse2, escapeSse2};
+#endif
+            return EscapeFunctions{nullptr, nullptr};
+        }
+
+        const EscapeFunctions escapeFunctions = selectEscapeFunctions();
+    } // namespace
+
+    size_t escapedSize(std::string_view s)
+    {
+        if (s.size() < minVectorSize || !escapeFunctions.size)
+            return s.size() + extraScalar(s.data(), s.size());
+        return escapeFunctions.size(s.data(), s.size());
+    }
+
+    char *escapeTo(char *out, std::string_view s)
+    {
+        if (s.size() < minVectorSize || !escapeFunctions.escape)
+            return escapeScalar(out, s.data(), s.size());
+        return escapeFunctions.escape(out, s.data(), s.size());
+    }
+
+} // namespace Json
@@ -0,0 +1,23 @@
+#ifndef ESCAPE_H
+#define ESCAPE_H
+
+#include <cstddef>
+#include <string_view>
+
+namespace Json
+{
+    /* Экранирование строки для записи JSON: '"', '\\' и символы меньше 0x20
+       (\b \f \n \r \t коротко, остальные \u00xx). Строка просматривается
+       блоками по 32 или 16 байт (AVX2 или SSE2), участки без экранирования
+       переносятся целиком. Запись совпадает с требованиями RFC 8785 */
+
+    /* длина экранированной записи s */
+    size_t escapedSize(std::string_view s);
+
+    /* пишет экранированную s в out, где места не меньше escapedSize(s);
+       возвращает конец записи */
+    char *escapeTo(char *out, std::string_view s);
+
+} // namespace Json
+
+#endif // ESCAPE_H
@@ -0,0 +1,344 @@
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "jsonlines.h"
+#include "mappedfile.h"
+
+namespace Json
+{
+    namespace
+    {
+        const size_t chunkSize = 1 << 20;
+
+        // разобранных, но не переданных кусков на один поток
+        const size_t chunksPerThread = 4;
+
+        bool blank(const char *b, const char *e)
+        {
+            for (; b < e; ++b)
+            {
+                if (*b != ' ' && *b != '\t' && *b != '\r')
+                    return false;
+            }
+            return true;
+        }
+
+        // memchr в glibc векторизован, поиск концов строк идёт блоками по 16-32 байта
+        void parseChunk(const char *b, const char *e, std::vector<Value> &out)
+        {
+            while (b < e)
+            {
+                const char *nl = (const char *)memchr(b, '\n', e - b);
+                const char *le = nl ? nl : e;
+                if (!blank(b, le))
+                    out.push_back(parseJson(b, le));
+                b = le + 1;
+            }
+        }
+
+        // начала кусков: каждый следующий начинается после конца строки
+        std::vector<const char *> splitChunks(const char *data, const char *end)
+        {
+            std::vector<const char *> res;
+            const char *p = data;
+            while (p < end)
+            {
+                res.push_back(p);
+                if ((size_t)(end - p) <= chunkSize)
+                    break;
+                const char *nl = (const char *)memchr(p + chunkSize, '\n', end - p - chunkSize);
+                p = nl ? nl + 1 : end;
+            }
+            res.push_back(end);
+            return res;
+        }
+
+        size_t deliverSerial(const std::vector<const char *> &bounds, const LineCallback &callback)
+        {
+            size_t n = 0;
+            std::vector<Value> values;
+            for (size_t i = 0; i + 1 < bounds.size(); ++i)
+            {
+                parseChunk(bounds[i], bounds[i + 1], values);
+                for (Value &v : values)
+                    callback(std::move(v));
+                n += values.size();
+                values.clear();
+            }
+            return n;
+        }
+
+        // очередной кусок берёт освободившийся поток; готовые куски ждут
+        // своей очереди в кольце слотов, вызывающий поток отдаёт их по порядку
+        class Batch
+        {
+        public:
+            Batch(const std::vector<const char *> &bounds, unsigned threads)
+                : _bounds(bounds), _chunks(bounds.size() - 1), _window(threads * chunksPerThread),
+                  _slots(_window), _next(0), _delivered(0), _stop(false)
+            {
+                for (Slot &s : _slots)
+                    s.chunk = SIZE_MAX;
+            }
+
+            void work()
+            {
+                std::vector<Value> values;
+                for (;;)
+                {
+                    size_t i = _next.fetch_add(1);
+                    if (i >= _chunks)
+                        return;
+
+                    {
+                        std::unique_lock<std::mutex> lock(_mutex);
+                        _free.wait(lock, [&] { return i < _delivered + _window || _stop; });
+                        if (_stop)
+                            return;
+                    }
+
+                    // исключение из рабочего потока передаётся в deliver
+                    try
+                    {
+                        parseChunk(_bounds[i], _bounds[i + 1], values);
+                    }
+                    catch (...)
+                    {
+                        fail(std::current_exception());
+                        return;
+                    }
+
+                    {
+                        std::lock_guard<std::mutex> lock(_mutex);
+                        Slot &s = _slots[i % _window];
+                        s.values.swap(values);
+                        s.chunk = i;
+                    }
+                    _ready.notify_all();
+                    values.clear();
+                }
+            }
+
+            size_t deliver(const LineCallback &callback)
+            {
+                size_t n = 0;
+                std::vector<Value> values;
+                for (size_t i = 0; i < _chunks; ++i)
+                {
+                    {
+                        std::unique_lock<std::mutex> lock(_mutex);
+                        Slot &s = _slots[i % _window];
+                        _ready.wait(lock, [&] { return s.chunk == i || _error; });
+                        if (s.chunk != i)
+                            std::rethrow_exception(_error);
+                        values.swap(s.values);
+                        s.chunk = SIZE_MAX;
+                        _delivered = i + 1;
+                    }
+                    _free.notify_all();
+
+                    for (Value &v : values)
+                        callback(std::move(v));
+                    n += values.size();
+                    values.clear();
+                }
+                return n;
+            }
+
+            void stop()
+            {
+                {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    _stop = true;
+                }
+                _free.notify_all();
+            }
+
+        private:
+            void fail(std::exception_ptr error)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    if (!_error)
+                        _error = error;
+                    _stop = true;
+                }
+                _free.notify_all();
+                _ready.notify_all();
+            }
+
+            struct Slot
+            {
+                size_t chunk; // номер разобранного куска или SIZE_MAX
+                std::vector<Value> values;
+            };
+
+            const std::vector<const char *> &_bounds;
+            const size_t _chunks;
+            const size_t _window;
+            std::vector<Slot> _slots;
+
+            std::atomic<size_t> _next;
+            size_t _delivered;
+            bool _stop;
+            std::exception_ptr _error; // первое исключение рабочего потока
+
+            std::mutex _mutex;
+            std::condition_variable _free;
+            std::condition_variable _ready;
+        };
+    } // namespace
+
+    ////////////////////////////////////////////////////////////////////////////////
+    //
+    //  JsonLinesPool
+    //
+    JsonLinesPool::JsonLinesPool(unsigned threads)
+        : _job(nullptr), _jobThreads(0), _running(0), _generation(0), _exit(false)
+    {
+        if (threads == 0)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+
+        _workers.reserve(threads);
+        for (unsigned t = 0; t < threads; ++t)
+            _workers.emplace_back(&JsonLinesPool::loop, this, t);
+    }
+
+    JsonLinesPool::~JsonLinesPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _exit = true;
+        }
+        _wake.notify_all();
+        for (std::thread &w : _workers)
+            w.join();
+    }
+
+    void JsonLinesPool::start(const std::function<void()> &job, unsigned n)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _job = &job;
+            _jobThreads = n;
+            _running = n;
+            ++_generation;
+        }
+        _wake.notify_all();
+    }
+
+    void JsonLinesPool::join()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _done.wait(lock, [&] { return _running == 0; });
+        _job = nullptr;
+    }
+
+    // задача не выбрасывает исключений: Batch::work перехватывает их сам
+    void JsonLinesPool::loop(unsigned index)
+    {
+        uint64_t seen = 0;
+        for (;;)
+        {
+            const std::function<void()> *job;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _wake.wait(lock, [&] { return _exit || _generation != seen; });
+                if (_exit)
+                    return;
+                seen = _generation;
+                if (index >= _jobThreads)
+                    continue;
+                job = _job;
+            }
+
+            (*job)();
+
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                if (--_running == 0)
+                    _done.notify_all();
+            }
+        }
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    //
+    //
+    //
+    size_t parseJsonLines(const char *data, const char *end, const LineCallback &callback,
+                          JsonLinesPool &pool)
+    {
+        std::vector<const char *> bounds = splitChunks(data, end);
+        size_t chunks = bounds.size() - 1;
+        unsigned threads = (unsigned)std::min<size_t>(pool.threads(), chunks);
+
+        if (threads <= 1)
+            return deliverSerial(bounds, callback);
+
+        std::lock_guard<std::mutex> use(pool._use);
+        Batch batch(bounds, threads);
+        std::function<void()> job = [&batch] { batch.work(); };
+        pool.start(job, threads);
+
+        size_t n = 0;
+        try
+        {
+            n = batch.deliver(callback);
+        }
+        catch (...)
+        {
+            batch.stop();
+            pool.join();
+            throw;
+        }
+
+        pool.join();
+        return n;
+    }
+
+    size_t parseJsonLines(const char *data, const char *end, const LineCallback &callback,
+                          unsigned threads)
+    {
+        if (threads == 0)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+
+        // одного куска хватает вызывающему потоку, пул не создаётся
+        std::vector<const char *> bounds = splitChunks(data, end);
+        size_t chunks = bounds.size() - 1;
+        if (threads <= 1 || chunks <= 1)
+            return deliverSerial(bounds, callback);
+
+        JsonLinesPool pool((unsigned)std::min<size_t>(threads, chunks));
+        return parseJsonLines(data, end, callback, pool);
+    }
+
+    bool parseJsonLinesFile(const char *fileName, const LineCallback &callback, std::string &error,
+                            unsigned threads)
+    {
+        MappedFile file;
+        if (!file.open(fileName, error))
+            return false;
+
+        parseJsonLines(file.data(), file.end(), callback, threads);
+        return true;
+    }
+
+    bool parseJsonLinesFile(const char *fileName, const LineCallback &callback, std::string &error,
+                            JsonLinesPool &pool)
+    {
+        MappedFile file;
+        if (!file.open(fileName, error))
+            return false;
+
+        parseJsonLines(file.data(), file.end(), callback, pool);
+        return true;
+    }
+
+} // namespace Json
@@ -0,0 +1,80 @@
+#ifndef JSONLINES_H
+#define JSONLINES_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "value.h"
+
+namespace Json
+{
+    /* получает очередную запись; вызывается в потоке, запустившем разбор */
+    typedef std::function<void(Value &&v)> LineCallback;
+
+    /* Разбор NDJSON (JSON Lines): по одной записи на строку, пустые строки
+       пропускаются. Вход делится по концам строк на куски около мегабайта,
+       куски разбираются parseJson на threads потоках (0 — по числу ядер),
+       а записи передаются в callback строго в порядке входа. Разобранные,
+       но ещё не переданные куски ограничены несколькими на поток, так что
+       медленный callback останавливает разбор, а не копит память.
+       Исключение из callback или из разбора (например, std::bad_alloc в
+       рабочем потоке) останавливает остальные потоки и выбрасывается в
+       вызывающем. Возвращает число записей */
+    size_t parseJsonLines(const char *data, const char *end, const LineCallback &callback,
+                          unsigned threads = 0);
+
+    /* Потоки для parseJsonLines, живущие между вызовами: при разборе многих
+       небольших файлов потоки не создаются заново на каждый вызов.
+       Вызовы с одним пулом из разных потоков выполняются по очереди */
+    class JsonLinesPool
+    {
+    public:
+        explicit JsonLinesPool(unsigned threads = 0);
+        ~JsonLinesPool();
+
+        JsonLinesPool(const JsonLinesPool &) = delete;
+        JsonLinesPool &operator=(const JsonLinesPool &) = delete;
+
+        unsigned threads() const { return (unsigned)_workers.size(); }
+
+    private:
+        friend size_t parseJsonLines(const char *data, const char *end, const LineCallback &callback,
+                                     JsonLinesPool &pool);
+
+        // job выполняется на первых n потоках; join ждёт их завершения
+        void start(const std::function<void()> &job, unsigned n);
+        void join();
+        void loop(unsigned index);
+
+        std::vector<std::thread> _workers;
+        std::mutex _use; // разбор, занявший пул
+
+        std::mutex _mutex;
+        std::condition_variable _wake;
+        std::condition_variable _done;
+        const std::function<void()> *_job;
+        unsigned _jobThreads;
+        unsigned _running;
+        uint64_t _generation;
+        bool _exit;
+    };
+
+    /* то же на потоках пула */
+    size_t parseJsonLines(const char *data, const char *end, const LineCallback &callback,
+                          JsonLinesPool &pool);
+
+    /* то же для файла, отображённого в память; при ошибке чтения
+       возвращает false и описание в error */
+    bool parseJsonLinesFile(const char *fileName, const LineCallback &callback, std::string &error,
+                            unsigned threads = 0);
+    bool parseJsonLinesFile(const char *fileName, const LineCallback &callback, std::string &error,
+                            JsonLinesPool &pool);
+
+} // namespace Json
+
+#endif // JSONLINES_H
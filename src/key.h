@@ -0,0 +1,67 @@
+#ifndef KEY_H
+#define KEY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace Json
+{
+    /* хеш ключа объекта, им пользуется индекс ObjectContainer. Ключ читается
+       словами по 8 байт (сборку слова из байтов компилятор сводит к одной
+       загрузке), поэтому хеш считается и во время компиляции */
+    constexpr uint64_t keyHash(std::string_view s)
+    {
+        const uint64_t k = 0x9E3779B97F4A7C15ULL;
+        uint64_t h = s.size() * k;
+        size_t i = 0, n = s.size();
+        for (; i + 8 <= n; i += 8)
+        {
+            uint64_t w = 0;
+            for (size_t j = 0; j < 8; ++j)
+                w |= (uint64_t)(unsigned char)s[i + j] << (8 * j);
+            h = (h ^ w) * k;
+            h ^= h >> 29;
+        }
+
+        uint64_t w = 0;
+        for (size_t j = 0; i + j < n; ++j)
+            w |= (uint64_t)(unsigned char)s[i + j] << (8 * j);
+        h = (h ^ w) * k;
+        return h ^ (h >> 32);
+    }
+
+    /* Ключ для поиска в объекте с заранее вычисленным хешем: объект с
+       хеш-индексом находит член без хеширования ключа. Строка не
+       копируется и должна жить дольше ключа; для литералов удобен
+       "name"_key, хеш которого считается при компиляции:
+           using namespace Json::literals;
+           static constexpr Json::Key id = "id"_key;
+           v[id].asInt(); */
+    class Key
+    {
+    public:
+        constexpr explicit Key(std::string_view key)
+            : _key(key), _hash(keyHash(key))
+        {
+        }
+
+        constexpr std::string_view view() const { return _key; }
+        constexpr uint64_t hash() const { return _hash; }
+
+    private:
+        std::string_view _key;
+        uint64_t _hash;
+    };
+
+    namespace literals
+    {
+        constexpr Key operator""_key(const char *s, size_t n)
+        {
+            return Key(std::string_view(s, n));
+        }
+    } // namespace literals
+
+} // namespace Json
+
+#endif // KEY_H
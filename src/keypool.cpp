@@ -0,0 +1,54 @@
+#include <atomic>
+#include <cstring>
+#include <mutex>
+
+#include "keypool.h"
+
+namespace Json
+{
+    namespace
+    {
+        std::atomic<KeyPool *> currentPool(nullptr);
+    } // namespace
+
+    KeyPool::KeyPool(size_t chunkSize)
+        : _arena(chunkSize)
+    {
+    }
+
+    std::string_view KeyPool::intern(std::string_view s)
+    {
+        {
+            std::shared_lock<std::shared_mutex> lock(_mutex);
+            auto i = _keys.find(s);
+            if (i != _keys.end())
+                return *i;
+        }
+
+        std::unique_lock<std::shared_mutex> lock(_mutex);
+        auto i = _keys.find(s);
+        if (i != _keys.end())
+            return *i;
+
+        char *p = (char *)_arena.allocate(s.size() ? s.size() : 1, 1);
+        memcpy(p, s.data(), s.size());
+        return *_keys.emplace(p, s.size()).first;
+    }
+
+    size_t KeyPool::size() const
+    {
+        std::shared_lock<std::shared_mutex> lock(_mutex);
+        return _keys.size();
+    }
+
+    void setKeyPool(KeyPool *pool)
+    {
+        currentPool.store(pool, std::memory_order_release);
+    }
+
+    KeyPool *keyPool()
+    {
+        return currentPool.load(std::memory_order_acquire);
+    }
+
+} // namespace Json
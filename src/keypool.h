@@ -0,0 +1,43 @@
+#ifndef KEYPOOL_H
+#define KEYPOOL_H
+
+#include <memory_resource>
+#include <shared_mutex>
+#include <string_view>
+#include <unordered_set>
+
+namespace Json
+{
+    /* Пул интернированных строк: каждая строка хранится один раз, и
+       одинаковые строки получают один адрес. Пул только растёт и
+       рассчитан на устойчивый словарь ключей. Потокобезопасен */
+    class KeyPool
+    {
+    public:
+        explicit KeyPool(size_t chunkSize = 64 * 1024);
+
+        KeyPool(const KeyPool &) = delete;
+        KeyPool &operator=(const KeyPool &) = delete;
+
+        /* постоянная копия s из пула */
+        std::string_view intern(std::string_view s);
+
+        /* число строк в пуле */
+        size_t size() const;
+
+    private:
+        mutable std::shared_mutex _mutex;
+        std::pmr::monotonic_buffer_resource _arena;
+        std::unordered_set<std::string_view> _keys;
+    };
+
+    /* пул, в котором объекты хранят ключи длиннее 15 байт: его используют
+       все разборщики и Value::operator[]. nullptr (по умолчанию) — каждый
+       объект хранит свои копии. Пул должен жить дольше всех значений,
+       созданных, пока он установлен */
+    void setKeyPool(KeyPool *pool);
+    KeyPool *keyPool();
+
+} // namespace Json
+
+#endif // KEYPOOL_H
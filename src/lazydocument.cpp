@@ -0,0 +1,279 @@
+#include <cstring>
+
+#include "lazydocument.h"
+#include "parser.h"
+#include "sax.h"
+
+namespace Json
+{
+    ////////////////////////////////////////////////////////////////////////////////
+    //
+    //  LazyValue
+    //
+    Value::Type LazyValue::type() const
+    {
+        if (_node)
+            return _node->type();
+        if (_pos == NONE)
+            return Value::Type::UNDEFINED;
+
+        switch (_doc->at(_pos))
+        {
+        case '{':
+            return Value::Type::OBJECT;
+        case '[':
+            return Value::Type::ARRAY;
+        case '\"':
+            return Value::Type::STRING;
+        default:
+            return value().type();
+        }
+    }
+
+    size_t LazyValue::size() const
+    {
+        if (_node)
+            return _node->size();
+        if (_pos == NONE)
+            return 0;
+
+        char c = _doc->at(_pos);
+        if (c != '{' && c != '[')
+            return 0;
+
+        // у объекта каждый член — ключ, ':' и значение
+        uint32_t close = _doc->_match[_pos];
+        size_t n = 0;
+        for (uint32_t k = _pos + 1; k < close; ++n)
+        {
+            if (c == '{')
+            {
+                if (_doc->at(k) != '\"' || k + 3 >= close)
+                    break;
+                k += 3;
+            }
+            k = _doc->skip(k);
+            if (k < close && _doc->at(k) == ',')
+                ++k;
+            else if (k != close)
+                break;
+        }
+        return n;
+    }
+
+    LazyValue LazyValue::operator[](std::string_view key) const
+    {
+        if (_node)
+            return LazyValue(_doc, &(*_node)[std::string(key)]);
+        if (_pos == NONE || _doc->at(_pos) != '{')
+            return LazyValue();
+
+        uint32_t close = _doc->_match[_pos];
+        uint32_t k = _pos + 1;
+        while (k < close)
+        {
+            // ключ занимает две кавычки, за ним ':'
+            if (_doc->at(k) != '\"' || k + 3 >= close || _doc->at(k + 2) != ':')
+                break;
+
+            uint32_t v = k + 3;
+            if (_doc->keyEquals(k, key))
+                return LazyValue(_doc, v);
+
+            k = _doc->skip(v);
+            if (k < close && _doc->at(k) == ',')
+                ++k;
+            else if (k != close)
+                break;
+        }
+        return LazyValue();
+    }
+
+    LazyValue LazyValue::operator[](size_t key) const
+    {
+        if (_node)
+            return LazyValue(_doc, &(*_node)[key]);
+        if (_pos == NONE || _doc->at(_pos) != '[')
+            return LazyValue();
+
+        uint32_t close = _doc->_match[_pos];
+        uint32_t k = _pos + 1;
+        while (k < close)
+        {
+            if (key-- == 0)
+                return LazyValue(_doc, k);
+
+            k = _doc->skip(k);
+            if (k < close && _doc->at(k) == ',')
+                ++k;
+            else if (k != close)
+                break;
+        }
+        return LazyValue();
+    }
+
+    bool LazyValue::hasKey(std::string_view key) const
+    {
+        if (_node)
+            return _node->hasKey(std::string(key));
+        return (*this)[key]._pos != NONE;
+    }
+
+    const Value &LazyValue::value() const
+    {
+        static const Value undefined;
+
+        if (_node)
+            return *_node;
+        if (_pos == NONE)
+            return undefined;
+        return _doc->materialize(_pos);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    //
+    //  LazyDocument
+    //
+    LazyDocument::LazyDocument()
+        : _data(nullptr), _end(nullptr), _lazy(true)
+    {
+    }
+
+    void LazyDocument::release()
+    {
+        _data = _end = nullptr;
+        _lazy = true;
+        _index.clear();
+        _match.clear();
+        _eager.reset();
+        _values.clear();
+        _file.close();
+    }
+
+    LazyValue LazyDocument::parse(const char *data, const char *end)
+    {
+        release();
+        return build(data, end);
+    }
+
+    LazyValue LazyDocument::parse(const char *data)
+    {
+        return parse(data, data + strlen(data));
+    }
+
+    bool LazyDocument::parseFile(const char *fileName)
+    {
+        release();
+        _error.clear();
+        if (!_file.open(fileName, _error))
+            return false;
+
+        build(_file.data(), _file.end());
+        return true;
+    }
+
+    LazyValue LazyDocument::build(const char *data, const char *end)
+    {
+        _data = data;
+        _end = end;
+        _lazy = buildStructuralIndex(data, end, _index) && matchBrackets();
+        if (!_lazy)
+        {
+            _index.clear();
+            _match.clear();
+            _eager = parseJson(data, end);
+        }
+        return root();
+    }
+
+    LazyValue LazyDocument::root() const
+    {
+        if (!_lazy)
+            return LazyValue(this, &_eager);
+        if (_index.empty())
+            return LazyValue();
+        return LazyValue(this, (uint32_t)0);
+    }
+
+    // один проход по индексу: для каждой открывающей скобки запоминает парную
+    bool LazyDocument::matchBrackets()
+    {
+        uint32_t n = (uint32_t)_index.size();
+        _match.resize(n);
+
+        std::vector<uint32_t> stack;
+        for (uint32_t k = 0; k < n; ++k)
+        {
+            switch (at(k))
+            {
+            case '{':
+            case '[':
+                stack.push_back(k);
+                break;
+
+            case '}':
+            case ']':
+                if (stack.empty() || at(stack.back()) != (at(k) == '}' ? '{' : '['))
+                    return false;
+                _match[stack.back()] = k;
+                stack.pop_back();
+                break;
+
+            // закрывающая кавычка всегда следующая в индексе
+            case '\"':
+                ++k;
+                break;
+
+            default:
+                break;
+            }
+        }
+        return stack.empty();
+    }
+
+    uint32_t LazyDocument::skip(uint32_t pos) const
+    {
+        switch (at(pos))
+        {
+        case '{':
+        case '[':
+            return _match[pos] + 1;
+        case '\"':
+            return pos + 2;
+        default:
+            return pos + 1;
+        }
+    }
+
+    bool LazyDocument::keyEquals(uint32_t pos, std::string_view key) const
+    {
+        const char *b = _data + _index[pos] + 1;
+        const char *e = _data + _index[pos + 1];
+        if (memchr(b, '\\', e - b) == nullptr)
+            return key == std::string_view(b, e - b);
+
+        // раскрытая строка не длиннее исходной
+        if ((size_t)(e - b) < key.size())
+            return false;
+        std::string buff(e - b, '\0');
+        buff.resize(unescapestringto(&buff[0], b, e - b));
+        return key == buff;
+    }
+
+    const Value &LazyDocument::materialize(uint32_t pos) const
+    {
+        auto i = _values.find(pos);
+        if (i != _values.end())
+            return i->second;
+
+        uint32_t last = skip(pos);
+        const char *b = _data + _index[pos];
+        const char *e = last < _index.size() ? _data + _index[last] : _end;
+
+        Value v;
+        if (!parseIndexed(_data, e, _index.data() + pos, _index.data() + last, nullptr, v))
+            v = parseJson(b, e);
+        return _values.emplace(pos, std::move(v)).first->second;
+    }
+
+} // namespace Json
@@ -0,0 +1,126 @@
+#ifndef LAZYDOCUMENT_H
+#define LAZYDOCUMENT_H
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "mappedfile.h"
+#include "structural.h"
+#include "value.h"
+
+namespace Json
+{
+    class LazyDocument;
+
+    /* Значение ленивого документа. Переход по ключу или номеру не строит
+       дерево и пропускает соседние значения прыжком через парные скобки;
+       Value создаётся только в value() и только для этого узла.
+       Действительно, пока жив документ и его входной буфер */
+    class LazyValue
+    {
+    public:
+        LazyValue()
+            : _doc(nullptr), _node(nullptr), _pos(NONE)
+        {
+        }
+
+        Value::Type type() const;
+        bool isUndefined() const { return type() == Value::Type::UNDEFINED; }
+        bool isString() const { return type() == Value::Type::STRING; }
+        bool isArray() const { return type() == Value::Type::ARRAY; }
+        bool isObject() const { return type() == Value::Type::OBJECT; }
+
+        /* число элементов массива или членов объекта (повторные ключи
+           считаются, как записаны) */
+        size_t size() const;
+
+        /* первое значение с ключом key, как в parseJson */
+        LazyValue operator[](std::string_view key) const;
+        LazyValue operator[](size_t key) const;
+        bool hasKey(std::string_view key) const;
+
+        /* строит дерево этого узла; повторный вызов возвращает то же значение */
+        const Value &value() const;
+
+    private:
+        friend class LazyDocument;
+
+        static const uint32_t NONE = UINT32_MAX;
+
+        LazyValue(const LazyDocument *doc, uint32_t pos)
+            : _doc(doc), _node(nullptr), _pos(pos)
+        {
+        }
+
+        LazyValue(const LazyDocument *doc, const Value *node)
+            : _doc(doc), _node(node), _pos(NONE)
+        {
+        }
+
+        const LazyDocument *_doc;
+        const Value *_node; // узел дерева, если документ разобран целиком
+        uint32_t _pos;      // первая лексема значения в структурном индексе
+    };
+
+    /* Документ, разбираемый по требованию: parse() строит только структурный
+       индекс и таблицу парных скобок, дерево не создаётся. Входной буфер не
+       копируется и должен жить дольше документа.
+       Если индекс построить нельзя (нет SIMD, незакрытая строка, непарные
+       скобки), документ разбирается целиком через parseJson.
+       Пропущенные поддеревья не проверяются: навигация рассчитана на
+       корректный JSON, некорректное значение value() разбирает так же
+       снисходительно, как parseJson. Документ не потокобезопасен даже
+       для чтения: value() кэширует построенные узлы */
+    class LazyDocument
+    {
+    public:
+        LazyDocument();
+
+        LazyDocument(const LazyDocument &) = delete;
+        LazyDocument &operator=(const LazyDocument &) = delete;
+
+        /* индексирует data..end, предыдущий разбор освобождается */
+        LazyValue parse(const char *data, const char *end);
+        LazyValue parse(const char *data);
+
+        /* отображает файл в память и индексирует его.
+           При ошибке возвращает false, описание — в error() */
+        bool parseFile(const char *fileName);
+        const std::string &error() const { return _error; }
+
+        LazyValue root() const;
+
+    private:
+        friend class LazyValue;
+
+        LazyValue build(const char *data, const char *end);
+        void release();
+        bool matchBrackets();
+
+        char at(uint32_t pos) const { return _data[_index[pos]]; }
+
+        /* лексема сразу за значением, начинающимся с pos */
+        uint32_t skip(uint32_t pos) const;
+
+        bool keyEquals(uint32_t pos, std::string_view key) const;
+        const Value &materialize(uint32_t pos) const;
+
+        const char *_data;
+        const char *_end;
+        bool _lazy;
+
+        StructuralIndex _index;
+        std::vector<uint32_t> _match; // для '{' и '[' — номер парной скобки
+        Value _eager;                 // дерево, если индекс построить не удалось
+
+        MappedFile _file;
+        std::string _error;
+
+        mutable std::unordered_map<uint32_t, Value> _values;
+    };
+
+} // namespace Json
+
+#endif // LAZYDOCUMENT_H
@@ -0,0 +1,73 @@
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "mappedfile.h"
+
+namespace Json
+{
+    MappedFile::MappedFile() : _data(""), _size(0), _mapped(false)
+    {
+    }
+
+    MappedFile::~MappedFile()
+    {
+        close();
+    }
+
+    bool MappedFile::open(const char *fileName, std::string &error)
+    {
+        close();
+
+        int fd = ::open(fileName, O_RDONLY);
+        if (fd < 0)
+        {
+            error = std::string(fileName) + ": " + strerror(errno);
+            return false;
+        }
+
+        struct stat st;
+        if (fstat(fd, &st) != 0)
+        {
+            error = std::string(fileName) + ": " + strerror(errno);
+            ::close(fd);
+            return false;
+        }
+
+        // пустой файл отобразить нельзя, он читается как пустой буфер
+        if (st.st_size == 0)
+        {
+            ::close(fd);
+            return true;
+        }
+
+        void *p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        int mmapErrno = errno;
+        ::close(fd);
+        if (p == MAP_FAILED)
+        {
+            error = std::string(fileName) + ": " + strerror(mmapErrno);
+            return false;
+        }
+
+        madvise(p, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+        _data = (const char *)p;
+        _size = (size_t)st.st_size;
+        _mapped = true;
+        return true;
+    }
+
+    void MappedFile::close()
+    {
+        if (_mapped)
+            munmap((void *)_data, _size);
+        _data = "";
+        _size = 0;
+        _mapped = false;
+    }
+
+} // namespace Json
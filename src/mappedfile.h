@@ -0,0 +1,36 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+
+namespace Json
+{
+    /* файл, отображённый в память только для чтения */
+    class MappedFile
+    {
+    public:
+        MappedFile();
+        ~MappedFile();
+
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        /* отображает файл с подсказкой последовательного чтения;
+           при ошибке возвращает false и описание в error */
+        bool open(const char *fileName, std::string &error);
+        void close();
+
+        const char *data() const { return _data; }
+        const char *end() const { return _data + _size; }
+        size_t size() const { return _size; }
+
+    private:
+        const char *_data;
+        size_t _size;
+        bool _mapped;
+    };
+
+} // namespace Json
+
+#endif // MAPPEDFILE_H
@@ -0,0 +1,266 @@
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <float.h>
+
+#include "number.h"
+#include "value.h"
+
+namespace Json
+{
+    namespace
+    {
+        // степени 10, точно представимые в double
+        const double exactPowers[] = {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+        inline bool isDigit(char c)
+        {
+            return (unsigned char)(c - '0') < 10;
+        }
+    } // namespace
+
+    const char *readNumber(const char *data, const char *end, Number &n)
+    {
+        n.integer = true;
+        n.i = 0;
+        n.d = 0;
+
+        const char *p = data;
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+'))
+        {
+            negative = *p == '-';
+            ++p;
+        }
+        // from_chars не принимает '+'
+        const char *number = negative ? data : p;
+
+        uint64_t w = 0;       // первые 19 значащих цифр
+        int digits = 0;       // значащих цифр в w
+        long long exp10 = 0;  // w * 10^exp10
+        bool truncated = false;
+        bool any = false;
+
+        for (; p < end && isDigit(*p); ++p)
+        {
+            any = true;
+            if (digits < 19)
+            {
+                w = w * 10 + (*p - '0');
+                digits += w != 0;
+            }
+            else
+            {
+                truncated |= *p != '0';
+                ++exp10;
+            }
+        }
+
+        bool fraction = false;
+        if (p < end && *p == '.')
+        {
+            fraction = true;
+            for (++p; p < end && isDigit(*p); ++p)
+            {
+                any = true;
+                if (digits < 19)
+                {
+                    w = w * 10 + (*p - '0');
+                    digits += w != 0;
+                    --exp10;
+                }
+                else
+                {
+                    truncated |= *p != '0';
+                }
+            }
+        }
+
+        if (!any)
+            return data;
+
+        bool exponent = false;
+        if (p < end && (*p == 'e' || *p == 'E'))
+        {
+            const char *e = p + 1;
+            bool negativeExp = false;
+            if (e < end && (*e == '-' || *e == '+'))
+            {
+                negativeExp = *e == '-';
+                ++e;
+            }
+            if (e < end && isDigit(*e))
+            {
+                exponent = true;
+                long long x = 0;
+                for (; e < end && isDigit(*e); ++e)
+                {
+                    if (x < 100000)
+                        x = x * 10 + (*e - '0');
+                }
+                exp10 += negativeExp ? -x : x;
+                p = e;
+            }
+        }
+
+        if (!fraction && !exponent && exp10 == 0)
+        {
+            if (w <= (uint64_t)INT64_MAX)
+            {
+                n.i = negative ? -(long long)w : (long long)w;
+                return p;
+            }
+            if (negative && w == (uint64_t)INT64_MAX + 1)
+            {
+                n.i = INT64_MIN;
+                return p;
+            }
+        }
+
+        n.integer = false;
+
+        // Clinger: мантисса и степень 10 точно представимы, одна операция округляет верно
+        if (!truncated && w <= (uint64_t(1) << 53) && exp10 >= -22 && exp10 <= 22)
+        {
+            double d = (double)w;
+            d = exp10 < 0 ? d / exactPowers[-exp10] : d * exactPowers[exp10];
+            n.d = negative ? -d : d;
+            return p;
+        }
+
+        // остальное — std::from_chars (Eisel-Lemire с точным запасным путём)
+        std::from_chars_result r = std::from_chars(number, p, n.d);
+        if (r.ec == std::errc::result_out_of_range)
+        {
+            n.d = exp10 > 0 ? HUGE_VAL : 0.0;
+            if (negative)
+                n.d = -n.d;
+        }
+        return p;
+    }
+
+    char *writeCanonicalNumber(char *out, double v)
+    {
+        if (v == 0)
+        {
+            *out++ = '0';
+            return out;
+        }
+        if (v < 0)
+        {
+            *out++ = '-';
+            v = -v;
+        }
+
+        // кратчайшие цифры d1..dk и порядок: v = 0.d1..dk * 10^n
+        char sci[32];
+        char *e = std::to_chars(sci, sci + sizeof(sci), v, std::chars_format::scientific).ptr;
+        char digits[20];
+        int k = 0;
+        const char *p = sci;
+        for (; p < e && *p != 'e'; ++p)
+        {
+            if (*p != '.')
+                digits[k++] = *p;
+        }
+        bool negativeExp = *++p == '-';
+        int exp = 0;
+        for (++p; p < e; ++p)
+            exp = exp * 10 + (*p - '0');
+        int n = (negativeExp ? -exp : exp) + 1;
+
+        if (k <= n && n <= 21)
+        {
+            memcpy(out, digits, k);
+            out += k;
+            memset(out, '0', n - k);
+            out += n - k;
+        }
+        else if (0 < n && n <= 21)
+        {
+            memcpy(out, digits, n);
+            out += n;
+            *out++ = '.';
+            memcpy(out, digits + n, k - n);
+            out += k - n;
+        }
+        else if (-6 < n && n <= 0)
+        {
+            *out++ = '0';
+            *out++ = '.';
+            memset(out, '0', -n);
+            out += -n;
+            memcpy(out, digits, k);
+            out += k;
+        }
+        else
+        {
+            *out++ = digits[0];
+            if (k > 1)
+            {
+                *out++ = '.';
+                memcpy(out, digits + 1, k - 1);
+                out += k - 1;
+            }
+            *out++ = 'e';
+            *out++ = n - 1 < 0 ? '-' : '+';
+            out = std::to_chars(out, out + 4, n - 1 < 0 ? 1 - n : n - 1).ptr;
+        }
+        return out;
+    }
+
+    char *writeNumber(char *out, double v)
+    {
+        // NaN и бесконечности в JSON не представимы
+        if (!(v <= DBL_MAX && v >= -DBL_MAX))
+        {
+            memcpy(out, "null", 4);
+            return out + 4;
+        }
+
+        // кратчайшая запись не длиннее 24 символов ("-2.2250738585072014e-308")
+        char *e = std::to_chars(out, out + 24, v).ptr;
+
+        // точка или порядок сохраняют тип NUMBER при обратном разборе
+        bool integral = true;
+        for (char *p = out; p < e; ++p)
+        {
+            if (*p == '.' || *p == 'e')
+            {
+                integral = false;
+                break;
+            }
+        }
+        if (integral)
+        {
+            *e++ = '.';
+            *e++ = '0';
+        }
+        return e;
+    }
+
+    char *writeNumber(char *out, long long v)
+    {
+        return std::to_chars(out, out + 20, v).ptr;
+    }
+
+    std::string &numberto(std::string &buff, double v)
+    {
+        size_t n = buff.size();
+        buff.resize(n + maxNumberSize);
+        buff.resize(writeNumber(&buff[n], v) - buff.data());
+        return buff;
+    }
+
+    std::string &numberto(std::string &buff, long long v)
+    {
+        size_t n = buff.size();
+        buff.resize(n + maxNumberSize);
+        buff.resize(writeNumber(&buff[n], v) - buff.data());
+        return buff;
+    }
+
+} // namespace Json
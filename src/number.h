@@ -0,0 +1,40 @@
+#ifndef NUMBER_H
+#define NUMBER_H
+
+#include <cstddef>
+
+namespace Json
+{
+    /* число, прочитанное readNumber */
+    struct Number
+    {
+        bool integer; // значение точно помещается в long long
+        long long i;
+        double d;
+    };
+
+    /* читает число [-+]digits[.digits][(e|E)[-+]digits] с начала data..end
+       без учёта локали. Целые без дробной части и порядка, помещающиеся в
+       long long, читаются точно, остальные — как double с корректным
+       округлением. Возвращает конец прочитанного; если цифр нет, n = 0 и
+       возвращается data */
+    const char *readNumber(const char *data, const char *end, Number &n);
+
+    /* наибольшая длина записи writeNumber */
+    const size_t maxNumberSize = 26;
+
+    /* записывают число в out, где места не меньше maxNumberSize, и возвращают
+       конец записи. double — кратчайшей записью с точкой или порядком, NaN и
+       бесконечности — как null (см. numberto) */
+    char *writeNumber(char *out, double v);
+    char *writeNumber(char *out, long long v);
+
+    /* записывает v так, как его выводит ECMAScript (Number::toString, RFC 8785):
+       кратчайшие цифры, читаемые обратно в то же значение; при значениях
+       от 1e-6 до 1e21 без порядка, "-0" записывается как "0". В out должно
+       быть не меньше 32 байт, возвращает конец записи */
+    char *writeCanonicalNumber(char *out, double v);
+
+} // namespace Json
+
+#endif // NUMBER_H
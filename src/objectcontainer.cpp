@@ -0,0 +1,265 @@
+#include <cstring>
+#include <tuple>
+
+#include "keypool.h"
+#include "value.h"
+
+namespace Json
+{
+    ObjectContainer::ObjectContainer(const allocator_type &a)
+        : _items(a), _index(a)
+    {
+    }
+
+    ObjectContainer::ObjectContainer(const ObjectContainer &o, const allocator_type &a)
+        : _items(a), _index(o._index, a)
+    {
+        // значения копируются в ресурс контейнера
+        std::pmr::memory_resource *r = a.resource();
+        _items.reserve(o._items.size());
+        for (const value_type &p : o._items)
+            _items.emplace_back(std::piecewise_construct, std::forward_as_tuple(makeKey(p.first)), std::forward_as_tuple(p.second, r));
+    }
+
+    ObjectContainer::~ObjectContainer()
+    {
+        for (const value_type &p : _items)
+            freeKey(p.first);
+    }
+
+    void ObjectContainer::clear()
+    {
+        for (const value_type &p : _items)
+            freeKey(p.first);
+        _items.clear();
+        _index.clear();
+    }
+
+    // длинный ключ берётся из пула, если он задан, иначе копируется в память контейнера
+    ObjectKey ObjectContainer::makeKey(std::string_view key)
+    {
+        ObjectKey k;
+        if (key.size() <= ObjectKey::inlineCapacity)
+        {
+            k.setInline(key);
+        }
+        else if (KeyPool *pool = keyPool())
+        {
+            std::string_view s = pool->intern(key);
+            k.setExternal(s.data(), s.size(), ObjectKey::INTERNED);
+        }
+        else
+        {
+            char *p = (char *)_items.get_allocator().resource()->allocate(key.size(), 1);
+            memcpy(p, key.data(), key.size());
+            k.setExternal(p, key.size(), ObjectKey::OWNED);
+        }
+        return k;
+    }
+
+    void ObjectContainer::freeKey(const ObjectKey &key)
+    {
+        if (key._tag == ObjectKey::OWNED)
+            _items.get_allocator().resource()->deallocate(const_cast<char *>(key.pointer()), key.size(), 1);
+    }
+
+    // номер члена с ключом key или npos
+    size_t ObjectContainer::lookup(std::string_view key, uint64_t hash) const
+    {
+        if (_index.empty())
+        {
+            for (size_t i = 0, n = _items.size(); i < n; ++i)
+            {
+                if (_items[i].first == key)
+                    return i;
+            }
+            return npos;
+        }
+
+        size_t mask = _index.size() - 1;
+        for (size_t h = hash & mask;; h = (h + 1) & mask)
+        {
+            uint32_t e = _index[h];
+            if (e == 0)
+                return npos;
+            if (_items[e - 1].first == key)
+                return e - 1;
+        }
+    }
+
+    // capacity — степень двойки, заполнение не больше половины
+    void ObjectContainer::rebuildIndex(size_t capacity)
+    {
+        _index.assign(capacity, 0);
+        size_t mask = capacity - 1;
+        for (size_t i = 0, n = _items.size(); i < n; ++i)
+        {
+            size_t h = keyHash(_items[i].first) & mask;
+            while (_index[h])
+                h = (h + 1) & mask;
+            _index[h] = (uint32_t)(i + 1);
+        }
+    }
+
+    ObjectContainer::iterator ObjectContainer::find(std::string_view key)
+    {
+        size_t i = lookup(key, _index.empty() ? 0 : keyHash(key));
+        return i == npos ? _items.end() : _items.begin() + i;
+    }
+
+    ObjectContainer::const_iterator ObjectContainer::find(std::string_view key) const
+    {
+        size_t i = lookup(key, _index.empty() ? 0 : keyHash(key));
+        return i == npos ? _items.end() : _items.begin() + i;
+    }
+
+    ObjectContainer::iterator ObjectContainer::find(const Key &key)
+    {
+        size_t i = lookup(key.view(), key.hash());
+        return i == npos ? _items.end() : _items.begin() + i;
+    }
+
+    ObjectContainer::const_iterator ObjectContainer::find(const Key &key) const
+    {
+        size_t i = lookup(key.view(), key.hash());
+        return i == npos ? _items.end() : _items.begin() + i;
+    }
+
+    std::pair<ObjectContainer::iterator, bool> ObjectContainer::try_emplace(std::string_view key)
+    {
+        return insert(key, _index.empty() ? 0 : keyHash(key));
+    }
+
+    std::pair<ObjectContainer::iterator, bool> ObjectContainer::try_emplace(const Key &key)
+    {
+        return insert(key.view(), key.hash());
+    }
+
+    std::pair<ObjectContainer::iterator, bool> ObjectContainer::insert(std::string_view key, uint64_t hash)
+    {
+        size_t i = lookup(key, hash);
+        if (i != npos)
+            return std::make_pair(_items.begin() + i, false);
+
+        // новый член запоминает ресурс контейнера
+        _items.emplace_back(makeKey(key), Value(_items.get_allocator().resource()));
+
+        size_t n = _items.size();
+        if (!_index.empty() && n * 2 <= _index.size())
+        {
+            size_t mask = _index.size() - 1;
+            size_t h = hash & mask;
+            while (_index[h])
+                h = (h + 1) & mask;
+            _index[h] = (uint32_t)n;
+        }
+        else if (n > hashThreshold)
+        {
+            size_t capacity = 64;
+            while (capacity < n * 2)
+                capacity *= 2;
+            rebuildIndex(capacity);
+        }
+        return std::make_pair(_items.end() - 1, true);
+    }
+
+    size_t ObjectContainer::erase(std::string_view key)
+    {
+        size_t i = lookup(key, _index.empty() ? 0 : keyHash(key));
+        if (i == npos)
+            return 0;
+        erase(_items.begin() + i);
+        return 1;
+    }
+
+    // ячейка индекса, в которой записан член i
+    size_t ObjectContainer::slot(size_t i) const
+    {
+        size_t mask = _index.size() - 1;
+        size_t h = keyHash(_items[i].first) & mask;
+        while (_index[h] != i + 1)
+            h = (h + 1) & mask;
+        return h;
+    }
+
+    // удаление из линейного пробирования сдвигом назад: следующие ячейки
+    // цепочки, которые можно найти из освободившейся, переносятся в неё
+    void ObjectContainer::clearSlot(size_t h)
+    {
+        size_t mask = _index.size() - 1;
+        for (size_t j = (h + 1) & mask; _index[j]; j = (j + 1) & mask)
+        {
+            size_t home = keyHash(_items[_index[j] - 1].first) & mask;
+            bool between = h <= j ? h < home && home <= j : h < home || home <= j;
+            if (!between)
+            {
+                _index[h] = _index[j];
+                h = j;
+            }
+        }
+        _index[h] = 0;
+    }
+
+    // индекс без членов first..last, номера следующих уменьшаются на их число
+    void ObjectContainer::eraseFromIndex(size_t first, size_t last)
+    {
+        if (_items.size() - (last - first) <= hashThreshold)
+        {
+            _index.clear();
+            return;
+        }
+
+        for (size_t i = first; i < last; ++i)
+            clearSlot(slot(i));
+
+        // короткий хвост правится по ключам, длинный — проходом по индексу
+        size_t shift = last - first, n = _items.size();
+        if ((n - last) * 8 < _index.size())
+        {
+            for (size_t i = last; i < n; ++i)
+                _index[slot(i)] -= (uint32_t)shift;
+        }
+        else
+        {
+            for (uint32_t &e : _index)
+            {
+                if (e > last)
+                    e -= (uint32_t)shift;
+            }
+        }
+    }
+
+    ObjectContainer::iterator ObjectContainer::erase(const_iterator i)
+    {
+        return erase(i, i + 1);
+    }
+
+    ObjectContainer::iterator ObjectContainer::erase(const_iterator first, const_iterator last)
+    {
+        if (first == last)
+            return _items.begin() + (first - _items.begin());
+
+        // индекс правится, пока ключи на прежних местах
+        if (!_index.empty())
+            eraseFromIndex(first - _items.begin(), last - _items.begin());
+
+        for (const_iterator i = first; i != last; ++i)
+            freeKey(i->first);
+        return _items.erase(first, last);
+    }
+
+    bool ObjectContainer::operator==(const ObjectContainer &o) const
+    {
+        if (size() != o.size())
+            return false;
+
+        for (const value_type &p : _items)
+        {
+            const_iterator i = o.find(p.first);
+            if (i == o.end() || !(i->second == p.second))
+                return false;
+        }
+        return true;
+    }
+
+} // namespace Json
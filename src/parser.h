@@ -0,0 +1,18 @@
+#ifndef PARSER_H
+#define PARSER_H
+
+#include "value.h"
+
+namespace Json
+{
+    /* разбор JSON; при doc != nullptr узлы, ключи и строки размещаются в арене документа */
+    Json::Value parseJson(const char *data, const char *end, Document *doc);
+
+    /* строит корректное значение по отрезку структурного индекса first..last,
+       который должен быть разобран целиком; end — граница последней лексемы */
+    bool parseIndexed(const char *data, const char *end, const uint32_t *first, const uint32_t *last,
+                      Document *doc, Value &out);
+
+} // namespace Json
+
+#endif // PARSER_H
@@ -0,0 +1,369 @@
+#ifndef SAX_H
+#define SAX_H
+
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#include "number.h"
+
+namespace Json
+{
+    inline bool ISXDIGIT(char c)
+    {
+        switch (c)
+        {
+        case '0':
+        case '1':
+        case '2':
+        case '3':
+        case '4':
+        case '5':
+        case '6':
+        case '7':
+        case '8':
+        case '9':
+        case 'A':
+        case 'B':
+        case 'C':
+        case 'D':
+        case 'E':
+        case 'F':
+        case 'a':
+        case 'b':
+        case 'c':
+        case 'd':
+        case 'e':
+        case 'f':
+            return true;
+
+        default:
+            return false;
+        }
+    }
+
+    /* раскрывает escape-последовательности из v в buff (не меньше size байт),
+       возвращает длину результата */
+    size_t unescapestringto(char *buff, const char *v, size_t size);
+
+    /* пропускает содержимое строки; data остаётся на закрывающей кавычке.
+       escaped — внутри встретилась escape-последовательность */
+    inline const char *scanString(const char *&data, const char *end, bool &escaped)
+    {
+        const char *buf = data;
+        escaped = false;
+        while (data < end)
+        {
+            if ((unsigned char)(*data) < ' ')
+            {
+                goto PARSE_STRING_END;
+            }
+
+            switch (*data)
+            {
+            case '\\':
+            {
+                ++data;
+                escaped = true;
+
+                if (data < end)
+                {
+                    switch (*data)
+                    {
+                    case '\"':
+                    case '\\':
+                    case '/':
+                    case 'b':
+                    case 'f':
+                    case 'n':
+                    case 'r':
+                    case 't':
+                        ++data;
+                        break;
+
+                    case 'u':
+                        if (
+                            end - data > 4 && ISXDIGIT((int)*(data + 1)) && ISXDIGIT((int)*(data + 2)) && ISXDIGIT((int)*(data + 3)) && ISXDIGIT((int)*(data + 4)))
+                        {
+                            data += 5;
+                        }
+                        else
+                        {
+                            goto PARSE_STRING_END;
+                        }
+                        break;
+
+                    default:
+                        goto PARSE_STRING_END;
+                    }
+                }
+                else
+                {
+                    goto PARSE_STRING_END;
+                }
+            }
+            break;
+
+            case '\"':
+                goto PARSE_STRING_END;
+
+            default:
+                ++data;
+            }
+        }
+
+    PARSE_STRING_END:
+        return buf;
+    }
+
+    /* число с начала data; хвост некорректного числа пропускается целиком */
+    inline const char *scanNumber(const char *data, const char *end, Number &n)
+    {
+        data = readNumber(data, end, n);
+        while (data < end)
+        {
+            switch (*data)
+            {
+            case '-':
+            case '+':
+            case '.':
+            case 'E':
+            case 'e':
+            case '0':
+            case '1':
+            case '2':
+            case '3':
+            case '4':
+            case '5':
+            case '6':
+            case '7':
+            case '8':
+            case '9':
+                ++data;
+                break;
+
+            default:
+                return data;
+            }
+        }
+        return data;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    //
+    //  Событийный разбор JSON без построения дерева.
+    //
+    //  Handler — любой класс с методами
+    //      bool onNull();
+    //      bool onBool(bool v);
+    //      bool onInt(long long v);
+    //      bool onDouble(double v);
+    //      bool onString(std::string_view s);
+    //      bool onKey(std::string_view s);
+    //      bool onStartObject();
+    //      bool onEndObject();
+    //      bool onStartArray();
+    //      bool onEndArray();
+    //  false из обработчика прекращает разбор.
+    //
+    //  Грамматика та же, что у parseJson: некорректный ввод разбирается так
+    //  же снисходительно, а дерево, собранное ValueBuilder по событиям,
+    //  совпадает с результатом parseJson. Строки без escape-последовательностей
+    //  передаются без копирования и указывают во входной буфер, остальные —
+    //  в буфер разборщика; в обоих случаях s действительна до следующего события.
+    //
+    template <class Handler>
+    class SaxReader
+    {
+    public:
+        explicit SaxReader(Handler &handler)
+            : _handler(handler)
+        {
+        }
+
+        /* разбирает первое значение из data..end; data сдвигается за него.
+           false — разбор прерван обработчиком */
+        bool parse(const char *&data, const char *end)
+        {
+            return value(data, end);
+        }
+
+    private:
+        bool value(const char *&data, const char *end)
+        {
+            while (data < end)
+            {
+                switch (*data)
+                {
+                case '{':
+                    return object(++data, end);
+                case '[':
+                    return array(++data, end);
+                case '\"':
+                    return _handler.onString(string(++data, end));
+
+                case 'n':
+                    if ((end - data >= 4) && memcmp(data, "null", 4) == 0) {
+                        data += 4;
+                        return _handler.onNull();
+                    }
+                    ++data;
+                    break;
+
+                case 't':
+                    if ((end - data >= 4) && memcmp(data, "true", 4) == 0) {
+                        data += 4;
+                        return _handler.onBool(true);
+                    }
+                    ++data;
+                    break;
+
+                case 'f':
+                    if ((end - data >= 5) && memcmp(data, "false", 5) == 0) {
+                        data += 5;
+                        return _handler.onBool(false);
+                    }
+                    ++data;
+                    break;
+
+                case '-':
+                case '0':
+                case '1':
+                case '2':
+                case '3':
+                case '4':
+                case '5':
+                case '6':
+                case '7':
+                case '8':
+                case '9':
+                {
+                    Number n;
+                    data = scanNumber(data, end, n);
+                    return n.integer ? _handler.onInt(n.i) : _handler.onDouble(n.d);
+                }
+
+                default:
+                    ++data;
+                    break;
+                }
+            }
+            // значения нет до конца ввода
+            return _handler.onNull();
+        }
+
+        bool object(const char *&data, const char *end)
+        {
+            if (!_handler.onStartObject())
+                return false;
+
+            bool hasKey = false;
+            while (data < end)
+            {
+                switch (*data)
+                {
+                case ':':
+                case ',':
+                case ' ':
+                case '\n':
+                case '\r':
+                case '\t':
+                    ++data;
+                    break;
+
+                case '}':
+                case ']':
+                    ++data;
+                    return _handler.onEndObject();
+
+                case '\"':
+                    if (!hasKey) {
+                        if (!_handler.onKey(string(++data, end)))
+                            return false;
+                        hasKey = true;
+                        break;
+                    }
+                    // fall through
+
+                default:
+                    if (hasKey) {
+                        if (!value(data, end))
+                            return false;
+                        hasKey = false;
+                    }
+                    else {
+                        ++data;
+                    }
+                    break;
+                }
+            }
+            return _handler.onEndObject();
+        }
+
+        bool array(const char *&data, const char *end)
+        {
+            if (!_handler.onStartArray())
+                return false;
+
+            while (data < end)
+            {
+                switch (*data)
+                {
+                case ',':
+                case ' ':
+                case '\n':
+                case '\r':
+                case '\t':
+                    ++data;
+                    break;
+
+                case ']':
+                case '}':
+                    ++data;
+                    return _handler.onEndArray();
+
+                default:
+                    if (!value(data, end))
+                        return false;
+                }
+            }
+            return _handler.onEndArray();
+        }
+
+        std::string_view string(const char *&data, const char *end)
+        {
+            bool escaped;
+            const char *b = scanString(data, end, escaped);
+            const char *e = data;
+            if (data < end && *data == '\"')
+                ++data;
+
+            if (!escaped)
+                return std::string_view(b, e - b);
+
+            _buffer.resize(e - b);
+            _buffer.resize(unescapestringto(&_buffer[0], b, e - b));
+            return _buffer;
+        }
+
+        Handler &_handler;
+        std::string _buffer; // раскрытая строка с escape-последовательностями
+    };
+
+    /* разбирает первое значение из data..end, вызывая методы handler */
+    template <class Handler>
+    bool parseSax(const char *data, const char *end, Handler &handler)
+    {
+        SaxReader<Handler> reader(handler);
+        return reader.parse(data, end);
+    }
+
+    template <class Handler>
+    bool parseSax(const char *data, Handler &handler)
+    {
+        return parseSax(data, data + strlen(data), handler);
+    }
+
+} // namespace Json
+
+#endif // SAX_H
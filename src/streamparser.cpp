@@ -0,0 +1,279 @@
+#include <cstring>
+
+#include "sax.h"
+#include "streamparser.h"
+
+namespace Json
+{
+    StreamParser::StreamParser()
+    {
+        reset();
+    }
+
+    void StreamParser::reset()
+    {
+        _state = State::VALUE;
+        _escape = false;
+        _literal = nullptr;
+        _token.clear();
+        _builder.reset();
+    }
+
+    void StreamParser::feed(const char *data, size_t size)
+    {
+        const char *p = data;
+        const char *end = data + size;
+        while (p < end && !_builder.done())
+        {
+            switch (_state)
+            {
+            case State::STRING:
+                p = feedString(p, end);
+                break;
+
+            case State::NUMBER:
+                p = feedNumber(p, end);
+                break;
+
+            case State::LITERAL:
+                p = feedLiteral(p, end);
+                break;
+
+            case State::VALUE:
+                switch (*p)
+                {
+                case '{':
+                    _builder.onStartObject();
+                    ++p;
+                    break;
+
+                case '[':
+                    _builder.onStartArray();
+                    ++p;
+                    break;
+
+                case '}':
+                case ']':
+                    // лишняя закрывающая скобка закрывает текущий контейнер, как в parseJson
+                    _builder.onEndObject();
+                    ++p;
+                    break;
+
+                case '\"':
+                    _state = State::STRING;
+                    _escape = false;
+                    _token.clear();
+                    ++p;
+                    break;
+
+                case '-':
+                case '0':
+                case '1':
+                case '2':
+                case '3':
+                case '4':
+                case '5':
+                case '6':
+                case '7':
+                case '8':
+                case '9':
+                    _state = State::NUMBER;
+                    _token.clear();
+                    break;
+
+                case 'n':
+                    _literal = "null";
+                    _state = State::LITERAL;
+                    _token.clear();
+                    break;
+
+                case 't':
+                    _literal = "true";
+                    _state = State::LITERAL;
+                    _token.clear();
+                    break;
+
+                case 'f':
+                    _literal = "false";
+                    _state = State::LITERAL;
+                    _token.clear();
+                    break;
+
+                // пробелы, ',' и ':'
+                default:
+                    ++p;
+                    break;
+                }
+                break;
+            }
+        }
+    }
+
+    const char *StreamParser::feedString(const char *p, const char *end)
+    {
+        const char *b = p;
+        for (; p < end; ++p)
+        {
+            if (_escape)
+            {
+                _escape = false;
+                continue;
+            }
+            if (*p == '\\')
+            {
+                _escape = true;
+                continue;
+            }
+            // управляющий символ завершает строку, как в parseJson
+            if (*p == '\"' || (unsigned char)*p < ' ')
+                break;
+        }
+
+        if (p == end)
+        {
+            _token.append(b, p);
+            return p;
+        }
+
+        if (_token.empty())
+        {
+            string(b, p);
+        }
+        else
+        {
+            _token.append(b, p);
+            string(_token.data(), _token.data() + _token.size());
+        }
+
+        _state = State::VALUE;
+        return *p == '\"' ? p + 1 : p;
+    }
+
+    const char *StreamParser::feedNumber(const char *p, const char *end)
+    {
+        const char *b = p;
+        while (p < end)
+        {
+            switch (*p)
+            {
+            case '-':
+            case '+':
+            case '.':
+            case 'E':
+            case 'e':
+            case '0':
+            case '1':
+            case '2':
+            case '3':
+            case '4':
+            case '5':
+            case '6':
+            case '7':
+            case '8':
+            case '9':
+                ++p;
+                continue;
+            }
+            break;
+        }
+
+        if (p == end)
+        {
+            _token.append(b, p);
+            return p;
+        }
+
+        if (_token.empty())
+        {
+            number(b, p);
+        }
+        else
+        {
+            _token.append(b, p);
+            number(_token.data(), _token.data() + _token.size());
+        }
+
+        _state = State::VALUE;
+        return p;
+    }
+
+    const char *StreamParser::feedLiteral(const char *p, const char *end)
+    {
+        while (p < end && _literal[_token.size()] && *p == _literal[_token.size()])
+            _token.push_back(*p++);
+
+        if (_literal[_token.size()] == '\0')
+        {
+            switch (_literal[0])
+            {
+            case 'n':
+                _builder.onNull();
+                break;
+            case 't':
+                _builder.onBool(true);
+                break;
+            default:
+                _builder.onBool(false);
+                break;
+            }
+            _state = State::VALUE;
+        }
+        else if (p < end)
+        {
+            // не литерал: прочитанное пропускается, как в parseJson
+            _state = State::VALUE;
+        }
+        return p;
+    }
+
+    void StreamParser::string(const char *data, const char *end)
+    {
+        std::string_view s(data, end - data);
+        if (memchr(data, '\\', end - data))
+        {
+            _text.resize(end - data);
+            _text.resize(unescapestringto(&_text[0], data, end - data));
+            s = _text;
+        }
+
+        if (_builder.expectsKey())
+            _builder.onKey(s);
+        else
+            _builder.onString(s);
+    }
+
+    void StreamParser::number(const char *data, const char *end)
+    {
+        Number n;
+        scanNumber(data, end, n);
+        if (n.integer)
+            _builder.onInt(n.i);
+        else
+            _builder.onDouble(n.d);
+    }
+
+    Value StreamParser::finish()
+    {
+        if (!_builder.done())
+        {
+            switch (_state)
+            {
+            case State::STRING:
+                string(_token.data(), _token.data() + _token.size());
+                break;
+
+            case State::NUMBER:
+                number(_token.data(), _token.data() + _token.size());
+                break;
+
+            default:
+                break;
+            }
+        }
+
+        Value res = _builder.release();
+        reset();
+        return res;
+    }
+
+} // namespace Json
@@ -0,0 +1,60 @@
+#ifndef STREAMPARSER_H
+#define STREAMPARSER_H
+
+#include <string>
+
+#include "value.h"
+#include "valuebuilder.h"
+
+namespace Json
+{
+    /* Разбор JSON, поступающего фрагментами: состояние, в том числе
+       незаконченная строка, число или литерал, сохраняется между вызовами
+       feed(). Для корректного JSON результат совпадает с parseJson
+       для того же текста целиком. */
+    class StreamParser
+    {
+    public:
+        StreamParser();
+
+        /* разбирает очередной фрагмент; после завершения корневого
+           значения остаток ввода игнорируется, как в parseJson */
+        void feed(const char *data, size_t size);
+
+        /* дочитывает значение на конце ввода, возвращает результат и
+           готовит разборщик к следующему документу */
+        Value finish();
+
+        /* корневое значение разобрано полностью */
+        bool done() const { return _builder.done(); }
+
+        void reset();
+
+    private:
+        enum class State
+        {
+            VALUE,
+            STRING,
+            NUMBER,
+            LITERAL
+        };
+
+        const char *feedString(const char *p, const char *end);
+        const char *feedNumber(const char *p, const char *end);
+        const char *feedLiteral(const char *p, const char *end);
+
+        void string(const char *data, const char *end);
+        void number(const char *data, const char *end);
+
+        State _state;
+        bool _escape;      // в строке: предыдущий символ — '\'
+        const char *_literal; // ожидаемый литерал: null, true или false
+        std::string _token;   // начало лексемы из предыдущих фрагментов
+        std::string _text;    // раскрытая строка с escape-последовательностями
+
+        ValueBuilder _builder;
+    };
+
+} // namespace Json
+
+#endif // STREAMPARSER_H
@@ -0,0 +1,320 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <ostream>
+#include <unistd.h>
+
+#include "escape.h"
+#include "number.h"
+#include "streamwriter.h"
+
+namespace Json
+{
+    ////////////////////////////////////////////////////////////////////////////////
+    //
+    //  StreamWriter
+    //
+    StreamWriter::StreamWriter(int fd, size_t bufferSize)
+    {
+        _sink = [this, fd](const char *data, size_t size) {
+            while (size)
+            {
+                ssize_t n = ::write(fd, data, size);
+                if (n < 0)
+                {
+                    if (errno == EINTR)
+                        continue;
+                    _error = std::string("write: ") + strerror(errno);
+                    return false;
+                }
+                data += n;
+                size -= (size_t)n;
+            }
+            return true;
+        };
+        init(bufferSize);
+    }
+
+    StreamWriter::StreamWriter(FILE *file, size_t bufferSize)
+    {
+        _sink = [this, file](const char *data, size_t size) {
+            if (fwrite(data, 1, size, file) == size)
+                return true;
+            _error = std::string("fwrite: ") + strerror(errno);
+            return false;
+        };
+        init(bufferSize);
+    }
+
+    StreamWriter::StreamWriter(std::ostream &os, size_t bufferSize)
+    {
+        _sink = [&os](const char *data, size_t size) {
+            os.write(data, (std::streamsize)size);
+            return !os.fail();
+        };
+        init(bufferSize);
+    }
+
+    StreamWriter::StreamWriter(WriteCallback callback, size_t bufferSize)
+        : _sink(std::move(callback))
+    {
+        init(bufferSize);
+    }
+
+    void StreamWriter::init(size_t bufferSize)
+    {
+        if (bufferSize < minBufferSize)
+            bufferSize = minBufferSize;
+        _buffer.reset(new char[bufferSize]);
+        _pos = _buffer.get();
+        _end = _pos + bufferSize;
+        _pretty = false;
+        _members = nullptr;
+    }
+
+    StreamWriter::~StreamWriter()
+    {
+        flush();
+    }
+
+    bool StreamWriter::flush()
+    {
+        size_t size = _pos - _buffer.get();
+        _pos = _buffer.get();
+
+        // после ошибки текст отбрасывается
+        if (size && _error.empty() && !_sink(_buffer.get(), size) && _error.empty())
+            _error = "write failed";
+        return _error.empty();
+    }
+
+    bool StreamWriter::write(const Value &v, bool pretty, bool sorted)
+    {
+        _pretty = pretty;
+        _members = sorted ? &_memberStack : nullptr;
+        _memberStack.clear();
+        value(v, 0);
+        return _error.empty();
+    }
+
+    bool StreamWriter::writeRaw(std::string_view text)
+    {
+        append(text.data(), text.size());
+        return _error.empty();
+    }
+
+    void StreamWriter::append(const char *s, size_t n)
+    {
+        while (n)
+        {
+            if (_pos == _end)
+                flush();
+            size_t k = std::min(n, (size_t)(_end - _pos));
+            memcpy(_pos, s, k);
+            _pos += k;
+            s += k;
+            n -= k;
+        }
+    }
+
+    void StreamWriter::indent(size_t level)
+    {
+        for (size_t n = level * 4; n;)
+        {
+            if (_pos == _end)
+                flush();
+            size_t k = std::min(n, (size_t)(_end - _pos));
+            memset(_pos, ' ', k);
+            _pos += k;
+            n -= k;
+        }
+    }
+
+    void StreamWriter::string(std::string_view s)
+    {
+        // символ после экранирования занимает не больше 6 байт (\u00xx);
+        // длинная строка пишется кусками, экранирование от границ не зависит
+        const size_t maxEscaped = 6;
+        const size_t minChunk = 256;
+
+        put('\"');
+        while (!s.empty())
+        {
+            if ((size_t)(_end - _pos) < std::min(s.size(), minChunk) * maxEscaped)
+                flush();
+
+            size_t n = std::min(s.size(), (size_t)(_end - _pos) / maxEscaped);
+            _pos = escapeTo(_pos, s.substr(0, n));
+            s.remove_prefix(n);
+        }
+        put('\"');
+    }
+
+    // запись та же, что у stringifyto и prettyStringifyTo в value.cpp
+    void StreamWriter::value(const Value &v, size_t level)
+    {
+        switch (v.type())
+        {
+        case Value::Type::UNDEFINED:
+            append("null", 4);
+            break;
+
+        case Value::Type::BOOLEAN:
+            if (v.asBoolean())
+                append("true", 4);
+            else
+                append("false", 5);
+            break;
+
+        case Value::Type::INTEGER:
+            reserve(maxNumberSize);
+            _pos = writeNumber(_pos, v.asLongLong());
+            break;
+
+        case Value::Type::NUMBER:
+            reserve(maxNumberSize);
+            _pos = writeNumber(_pos, v.asNumber());
+            break;
+
+        case Value::Type::STRING:
+            string(v.asStringView());
+            break;
+
+        case Value::Type::ARRAY:
+        {
+            put('[');
+            if (_pretty)
+                put('\n');
+
+            const double *pn = v.packedNumbers();
+            const int64_t *pi = v.packedIntegers();
+            const ArrayContainer *a = pn || pi ? nullptr : v.asArray();
+            for (size_t i = 0, n = v.size(); i < n; ++i)
+            {
+                if (i)
+                {
+                    put(',');
+                    if (_pretty)
+                        put('\n');
+                }
+                if (_pretty)
+                    indent(level + 1);
+
+                if (pn)
+                {
+                    reserve(maxNumberSize);
+                    _pos = writeNumber(_pos, pn[i]);
+                }
+                else if (pi)
+                {
+                    reserve(maxNumberSize);
+                    _pos = writeNumber(_pos, (long long)pi[i]);
+                }
+                else
+                {
+                    value((*a)[i], level + 1);
+                }
+            }
+
+            if (_pretty)
+            {
+                put('\n');
+                indent(level);
+            }
+            put(']');
+            break;
+        }
+
+        case Value::Type::OBJECT:
+        {
+            const ObjectContainer &o = *v.asObject();
+            put('{');
+            if (_pretty)
+                put('\n');
+
+            auto member = [&](const ObjectContainer::value_type &p, bool first) {
+                if (!first)
+                {
+                    put(',');
+                    if (_pretty)
+                        put('\n');
+                }
+                if (_pretty)
+                    indent(level + 1);
+                string(p.first);
+                put(':');
+                value(p.second, level + 1);
+            };
+
+            if (_members)
+            {
+                // стек растёт при вложенных объектах, поэтому обход по номерам
+                size_t base = _members->size();
+                for (const auto &p : o)
+                    _members->push_back(&p);
+                std::sort(_members->begin() + base, _members->end(),
+                          [](const ObjectContainer::value_type *a, const ObjectContainer::value_type *b) {
+                              return a->first.view() < b->first.view();
+                          });
+
+                for (size_t i = base, n = _members->size(); i < n; ++i)
+                    member(*(*_members)[i], i == base);
+                _members->resize(base);
+            }
+            else
+            {
+                bool first = true;
+                for (const auto &p : o)
+                {
+                    member(p, first);
+                    first = false;
+                }
+            }
+
+            if (_pretty)
+            {
+                put('\n');
+                indent(level);
+            }
+            put('}');
+            break;
+        }
+
+        default:
+            break;
+        }
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    //
+    //
+    //
+    bool writeJsonFile(const char *fileName, const Value &v, std::string &error,
+                       bool pretty, bool sorted)
+    {
+        int fd = ::open(fileName, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        if (fd < 0)
+        {
+            error = std::string(fileName) + ": " + strerror(errno);
+            return false;
+        }
+
+        bool ok;
+        {
+            StreamWriter writer(fd);
+            writer.write(v, pretty, sorted);
+            ok = writer.flush();
+            if (!ok)
+                error = std::string(fileName) + ": " + writer.error();
+        }
+
+        if (::close(fd) != 0 && ok)
+        {
+            error = std::string(fileName) + ": " + strerror(errno);
+            ok = false;
+        }
+        return ok;
+    }
+
+} // namespace Json
@@ -0,0 +1,105 @@
+#ifndef STREAMWRITER_H
+#define STREAMWRITER_H
+
+#include <cstdio>
+#include <functional>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "value.h"
+
+namespace Json
+{
+    /* приёмник записи: получает очередной заполненный кусок буфера;
+       false — ошибка, дальнейшая запись прекращается */
+    typedef std::function<bool(const char *data, size_t size)> WriteCallback;
+
+    /* Потоковая запись Value в файловый дескриптор, FILE *, std::ostream или
+       callback. Текст собирается в буфере постоянного размера и уходит в
+       приёмник каждый раз, когда буфер заполняется, так что первые байты
+       выходят сразу, а память не зависит от размера документа: кроме буфера
+       нужен только стек обхода (при sorted ещё указатели на члены открытых
+       объектов). Запись совпадает со stringify и prettyStringify.
+
+       Ошибка приёмника запоминается, остальная запись пропускается; write и
+       flush тогда возвращают false, описание — в error() */
+    class StreamWriter
+    {
+    public:
+        static const size_t defaultBufferSize = 64 * 1024;
+
+        /* наименьший буфер, вмещает любое число и экранированный кусок
+           строки; меньший размер увеличивается до него */
+        static const size_t minBufferSize = 4096;
+
+        explicit StreamWriter(int fd, size_t bufferSize = defaultBufferSize);
+        explicit StreamWriter(FILE *file, size_t bufferSize = defaultBufferSize);
+        explicit StreamWriter(std::ostream &os, size_t bufferSize = defaultBufferSize);
+        explicit StreamWriter(WriteCallback callback, size_t bufferSize = defaultBufferSize);
+
+        /* отдаёт приёмнику остаток буфера; дескриптор, FILE * и ostream
+           не закрываются */
+        ~StreamWriter();
+
+        StreamWriter(const StreamWriter &) = delete;
+        StreamWriter &operator=(const StreamWriter &) = delete;
+
+        /* дописывает v; pretty — с отступами, как prettyStringify,
+           sorted — ключи объектов по возрастанию */
+        bool write(const Value &v, bool pretty = false, bool sorted = false);
+
+        /* дописывает текст как есть, например перевод строки между записями NDJSON */
+        bool writeRaw(std::string_view text);
+
+        /* отдаёт приёмнику заполненную часть буфера */
+        bool flush();
+
+        bool ok() const { return _error.empty(); }
+        const std::string &error() const { return _error; }
+
+    private:
+        typedef std::vector<const ObjectContainer::value_type *> MemberList;
+
+        void init(size_t bufferSize);
+
+        void value(const Value &v, size_t level);
+        void string(std::string_view s);
+        void indent(size_t level);
+        void append(const char *s, size_t n);
+
+        // свободного места в буфере не меньше n (n не больше minBufferSize)
+        void reserve(size_t n)
+        {
+            if ((size_t)(_end - _pos) < n)
+                flush();
+        }
+
+        void put(char c)
+        {
+            if (_pos == _end)
+                flush();
+            *_pos++ = c;
+        }
+
+        WriteCallback _sink;
+        std::unique_ptr<char[]> _buffer;
+        char *_pos;
+        char *_end;
+        std::string _error;
+
+        bool _pretty;
+        MemberList *_members; // стек членов при sorted, иначе nullptr
+        MemberList _memberStack;
+    };
+
+    /* записывает v в файл fileName (создаёт или перезаписывает) через
+       StreamWriter; при ошибке возвращает false и описание в error */
+    bool writeJsonFile(const char *fileName, const Value &v, std::string &error,
+                       bool pretty = false, bool sorted = false);
+
+} // namespace Json
+
+#endif // STREAMWRITER_H
@@ -0,0 +1,211 @@
+#include <cstring>
+
+#include "structural.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define JSON_STRUCTURAL_X86 1
+#include <immintrin.h>
+#endif
+
+namespace Json
+{
+    namespace
+    {
+        // побитовая классификация 64 байт входа
+        struct BlockMasks
+        {
+            uint64_t op;    // {}[]:,
+            uint64_t ws;    // пробел, \t, \n, \r
+            uint64_t quote; // "
+            uint64_t bs;    // обратная косая черта
+            uint64_t ctrl;  // байты < 0x20
+        };
+
+        inline uint64_t prefixXor(uint64_t x)
+        {
+            x ^= x << 1;
+            x ^= x << 2;
+            x ^= x << 4;
+            x ^= x << 8;
+            x ^= x << 16;
+            x ^= x << 32;
+            return x;
+        }
+
+        // состояние, переносимое между блоками
+        struct Scanner
+        {
+            uint64_t prevEscaped = 0;
+            uint64_t prevInString = 0;
+            uint64_t prevScalar = 0;
+            uint64_t ctrlInString = 0;
+
+            inline uint64_t next(const BlockMasks &m)
+            {
+                // символы, экранированные нечётной серией '\'
+                const uint64_t evenBits = 0x5555555555555555ULL;
+                uint64_t bs = m.bs & ~prevEscaped;
+                uint64_t followsEscape = bs << 1 | prevEscaped;
+                uint64_t oddStarts = bs & ~evenBits & ~followsEscape;
+                uint64_t evenSequences;
+                prevEscaped = __builtin_add_overflow(oddStarts, bs, &evenSequences);
+                uint64_t escaped = (evenBits ^ (evenSequences << 1)) & followsEscape;
+
+                // открывающая кавычка и содержимое строки, без закрывающей
+                uint64_t quote = m.quote & ~escaped;
+                uint64_t inString = prefixXor(quote) ^ prevInString;
+                prevInString = (uint64_t)((int64_t)inString >> 63);
+
+                ctrlInString |= m.ctrl & inString;
+
+                // начала чисел и литералов
+                uint64_t scalar = ~(m.op | m.ws | quote | inString);
+                uint64_t followsScalar = scalar << 1 | prevScalar;
+                prevScalar = scalar >> 63;
+
+                return (m.op & ~inString) | quote | (scalar & ~followsScalar);
+            }
+        };
+
+        inline void flatten(StructuralIndex &index, uint64_t bits, uint32_t base)
+        {
+            size_t n = index.size();
+            index.resize(n + __builtin_popcountll(bits));
+            uint32_t *out = index.data() + n;
+            while (bits)
+            {
+                *out++ = base + (uint32_t)__builtin_ctzll(bits);
+                bits &= bits - 1;
+            }
+        }
+
+#ifdef JSON_STRUCTURAL_X86
+        __attribute__((target("avx2"))) inline uint64_t eq64(__m256i lo, __m256i hi, char c)
+        {
+            __m256i v = _mm256_set1_epi8(c);
+            uint64_t l = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, v));
+            uint64_t h = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, v));
+            return l | h << 32;
+        }
+
+        __attribute__((target("avx2"))) inline void classifyAvx2(const char *p, BlockMasks &m)
+        {
+            __m256i lo = _mm256_loadu_si256((const __m256i *)p);
+            __m256i hi = _mm256_loadu_si256((const __m256i *)(p + 32));
+
+            m.op = eq64(lo, hi, '{') | eq64(lo, hi, '}') | eq64(lo, hi, '[') |
+                   eq64(lo, hi, ']') | eq64(lo, hi, ':') | eq64(lo, hi, ',');
+            m.ws = eq64(lo, hi, ' ') | eq64(lo, hi, '\t') | eq64(lo, hi, '\n') | eq64(lo, hi, '\r');
+            m.quote = eq64(lo, hi, '\"');
+            m.bs = eq64(lo, hi, '\\');
+
+            // x <= 0x1F без знака
+            __m256i c = _mm256_set1_epi8(0x1F);
+            uint64_t l = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_min_epu8(lo, c), lo));
+            uint64_t h = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_min_epu8(hi, c), hi));
+            m.ctrl = l | h << 32;
+        }
+
+        __attribute__((target("avx2"))) bool indexAvx2(const char *data, size_t size, StructuralIndex &index)
+        {
+            Scanner s;
+            BlockMasks m;
+            size_t i = 0;
+            for (; i + 64 <= size; i += 64)
+            {
+                classifyAvx2(data + i, m);
+                flatten(index, s.next(m), (uint32_t)i);
+            }
+            if (i < size)
+            {
+                char tail[64];
+                memset(tail, ' ', sizeof(tail));
+                memcpy(tail, data + i, size - i);
+                classifyAvx2(tail, m);
+                flatten(index, s.next(m), (uint32_t)i);
+            }
+            return s.prevInString == 0 && s.ctrlInString == 0;
+        }
+
+        __attribute__((target("sse4.2"))) inline uint64_t eq16(const __m128i *v, char c)
+        {
+            __m128i x = _mm_set1_epi8(c);
+            uint64_t r = 0;
+            for (int k = 0; k < 4; ++k)
+                r |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v[k], x)) << (16 * k);
+            return r;
+        }
+
+        __attribute__((target("sse4.2"))) inline void classifySse42(const char *p, BlockMasks &m)
+        {
+            __m128i v[4];
+            for (int k = 0; k < 4; ++k)
+                v[k] = _mm_loadu_si128((const __m128i *)(p + 16 * k));
+
+            m.op = eq16(v, '{') | eq16(v, '}') | eq16(v, '[') |
+                   eq16(v, ']') | eq16(v, ':') | eq16(v, ',');
+            m.ws = eq16(v, ' ') | eq16(v, '\t') | eq16(v, '\n') | eq16(v, '\r');
+            m.quote = eq16(v, '\"');
+            m.bs = eq16(v, '\\');
+
+            __m128i c = _mm_set1_epi8(0x1F);
+            m.ctrl = 0;
+            for (int k = 0; k < 4; ++k)
+                m.ctrl |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(v[k], c), v[k])) << (16 * k);
+        }
+
+        __attribute__((target("sse4.2"))) bool indexSse42(const char *data, size_t size, StructuralIndex &index)
+        {
+            Scanner s;
+            BlockMasks m;
+            size_t i = 0;
+            for (; i + 64 <= size; i += 64)
+            {
+                classifySse42(data + i, m);
+                flatten(index, s.next(m), (uint32_t)i);
+            }
+            if (i < size)
+            {
+                char tail[64];
+                memset(tail, ' ', sizeof(tail));
+                memcpy(tail, data + i, size - i);
+                classifySse42(tail, m);
+                flatten(index, s.next(m), (uint32_t)i);
+            }
+            return s.prevInString == 0 && s.ctrlInString == 0;
+        }
+#endif
+
+        typedef bool (*IndexFunction)(const char *, size_t, StructuralIndex &);
+
+        IndexFunction selectIndexFunction()
+        {
+#ifdef JSON_STRUCTURAL_X86
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2"))
+                return indexAvx2;
+            if (__builtin_cpu_supports("sse4.2"))
+                return indexSse42;
+#endif
+            return nullptr;
+        }
+
+        const IndexFunction indexFunction = selectIndexFunction();
+    } // namespace
+
+    bool hasStructuralIndex()
+    {
+        return indexFunction != nullptr;
+    }
+
+    bool buildStructuralIndex(const char *data, const char *end, StructuralIndex &index)
+    {
+        size_t size = end - data;
+        index.clear();
+        if (!indexFunction || size >= UINT32_MAX)
+            return false;
+
+        return indexFunction(data, size, index);
+    }
+
+} // namespace Json
@@ -0,0 +1,23 @@
+#ifndef STRUCTURAL_H
+#define STRUCTURAL_H
+
+#include <cstdint>
+#include <vector>
+
+namespace Json
+{
+    /* позиции структурных символов {}[]:, вне строк, всех неэкранированных
+       кавычек и первых символов скаляров (чисел и литералов) */
+    typedef std::vector<uint32_t> StructuralIndex;
+
+    /* true, если процессор поддерживает SIMD-построение индекса */
+    bool hasStructuralIndex();
+
+    /* строит структурный индекс блоками по 64 байта (AVX2 или SSE4.2).
+       Возвращает false, если SIMD недоступен, вход больше 4 ГБ, строка не
+       закрыта или внутри строки есть управляющий символ */
+    bool buildStructuralIndex(const char *data, const char *end, StructuralIndex &index);
+
+} // namespace Json
+
+#endif // STRUCTURAL_H
@@ -0,0 +1,403 @@
+#include <cfloat>
+#include <cstring>
+
+#include "mappedfile.h"
+#include "sax.h"
+#include "tape.h"
+
+namespace Json
+{
+    ////////////////////////////////////////////////////////////////////////////////
+    //
+    //  TapeBuilder
+    //
+    //  Обработчик SaxReader, который дописывает события на ленту. Смещение
+    //  и число элементов контейнера известны только на закрывающей скобке,
+    //  тогда открывающее слово и заполняется.
+    //
+    class TapeBuilder
+    {
+    public:
+        explicit TapeBuilder(Tape &tape)
+            : _words(tape._words), _strings(tape._strings), _key(NONE)
+        {
+        }
+
+        bool onNull() { return scalar('n'); }
+        bool onBool(bool v) { return scalar(v ? 't' : 'f'); }
+
+        bool onInt(long long v)
+        {
+            uint64_t w;
+            memcpy(&w, &v, sizeof(w));
+            return number('l', w);
+        }
+
+        bool onDouble(double v)
+        {
+            // NaN и бесконечность, как в Value, — пустое значение
+            if (!((v <= DBL_MAX) && (v >= -DBL_MAX)))
+                return scalar('n');
+
+            uint64_t w;
+            memcpy(&w, &v, sizeof(w));
+            return number('d', w);
+        }
+
+        bool onString(std::string_view s)
+        {
+            member();
+            string(s);
+            return true;
+        }
+
+        bool onKey(std::string_view s)
+        {
+            _key = (uint32_t)_words.size();
+            string(s);
+            return true;
+        }
+
+        bool onStartObject() { return begin('{'); }
+        bool onEndObject() { return end('}'); }
+        bool onStartArray() { return begin('['); }
+        bool onEndArray() { return end(']'); }
+
+    private:
+        static const uint32_t NONE = UINT32_MAX;
+
+        struct Frame
+        {
+            uint32_t open;  // номер открывающего слова
+            uint32_t count; // элементов записано
+        };
+
+        // очередное значение в текущем контейнере
+        void member()
+        {
+            if (!_stack.empty())
+                ++_stack.back().count;
+            _key = NONE;
+        }
+
+        bool scalar(char tag)
+        {
+            member();
+            _words.push_back(Tape::makeWord(tag, 0));
+            return true;
+        }
+
+        bool number(char tag, uint64_t w)
+        {
+            member();
+            _words.push_back(Tape::makeWord(tag, 0));
+            _words.push_back(w);
+            return true;
+        }
+
+        void string(std::string_view s)
+        {
+            size_t offset = _strings.size();
+            uint32_t n = (uint32_t)s.size();
+            _strings.resize(offset + sizeof(n) + n + 1);
+            char *p = &_strings[offset];
+            memcpy(p, &n, sizeof(n));
+            memcpy(p + sizeof(n), s.data(), n);
+            p[sizeof(n) + n] = 0;
+            _words.push_back(Tape::makeWord('\"', offset));
+        }
+
+        bool begin(char tag)
+        {
+            member();
+            _stack.push_back(Frame{(uint32_t)_words.size(), 0});
+            _words.push_back(Tape::makeWord(tag, 0));
+            return true;
+        }
+
+        bool end(char tag)
+        {
+            // ключ без значения в конце объекта не записывается, как в parseJson
+            if (_key != NONE)
+            {
+                _strings.resize(_words[_key] & Tape::payloadMask);
+                _words.resize(_key);
+                _key = NONE;
+            }
+
+            Frame f = _stack.back();
+            _stack.pop_back();
+
+            uint64_t count = f.count < Tape::countLimit ? f.count : Tape::countLimit;
+            uint32_t next = (uint32_t)_words.size() + 1;
+            _words[f.open] |= (count << 32) | next;
+            _words.push_back(Tape::makeWord(tag, f.open));
+            return true;
+        }
+
+        std::vector<uint64_t> &_words;
+        std::vector<char> &_strings;
+        std::vector<Frame> _stack;
+        uint32_t _key; // слово ключа, для которого ещё нет значения
+    };
+
+    ////////////////////////////////////////////////////////////////////////////////
+    //
+    //  Tape
+    //
+    Tape::Tape()
+    {
+        _words.push_back(makeWord('n', 0));
+    }
+
+    TapeValue Tape::parse(const char *data, const char *end)
+    {
+        _words.clear();
+        _strings.clear();
+        _error.clear();
+
+        // номера слов 32-битные
+        if ((uint64_t)(end - data) >= UINT32_MAX)
+        {
+            _error = "input is larger than 4 GB";
+            _words.push_back(makeWord('n', 0));
+            return root();
+        }
+
+        // обычно слово приходится на 4-8 байт входа, строки занимают не больше его
+        size_t size = end - data;
+        _words.reserve(size / 4 + 2);
+        _strings.reserve(size / 2);
+
+        TapeBuilder builder(*this);
+        parseSax(data, end, builder);
+        return root();
+    }
+
+    TapeValue Tape::parse(const char *data)
+    {
+        return parse(data, data + strlen(data));
+    }
+
+    bool Tape::parseFile(const char *fileName)
+    {
+        MappedFile file;
+        if (!file.open(fileName, _error))
+            return false;
+
+        parse(file.data(), file.end());
+        return _error.empty();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    //
+    //  TapeValue
+    //
+    bool TapeValue::asBoolean(bool defaultValue) const
+    {
+        switch (tag())
+        {
+        case 't':
+            return true;
+        case 'f':
+            return false;
+        case 'l':
+            return asLongLong() != 0;
+        case 'd':
+            return asNumber() != 0;
+        case '\"':
+            return !asStringView().empty();
+        default:
+            return defaultValue;
+        }
+    }
+
+    double TapeValue::asNumber(double defaultValue) const
+    {
+        switch (tag())
+        {
+        case 't':
+            return 1;
+        case 'f':
+            return 0;
+        case 'l':
+            return (double)asLongLong();
+        case 'd':
+        {
+            double d;
+            memcpy(&d, &_tape->_words[_pos + 1], sizeof(d));
+            return d;
+        }
+        case '\"':
+            return Value(std::string(asStringView())).asNumber(defaultValue);
+        default:
+            return defaultValue;
+        }
+    }
+
+    long TapeValue::asLong(long defaultValue) const
+    {
+        return (long)asLongLong(defaultValue);
+    }
+
+    long long TapeValue::asLongLong(long long defaultValue) const
+    {
+        switch (tag())
+        {
+        case 't':
+            return 1;
+        case 'f':
+            return 0;
+        case 'l':
+        {
+            long long i;
+            memcpy(&i, &_tape->_words[_pos + 1], sizeof(i));
+            return i;
+        }
+        case 'd':
+            return (long long)asNumber();
+        case '\"':
+            return Value(std::string(asStringView())).asLongLong(defaultValue);
+        default:
+            return defaultValue;
+        }
+    }
+
+    int TapeValue::asInt(int defaultValue) const
+    {
+        return (int)asLongLong(defaultValue);
+    }
+
+    std::string TapeValue::asString(const std::string &defaultValue) const
+    {
+        switch (tag())
+        {
+        case '[':
+            return "Array[]";
+        case '{':
+            return "Object{}";
+        case '\"':
+            return std::string(asStringView());
+        default:
+            return toValue().asString(defaultValue);
+        }
+    }
+
+    std::string_view TapeValue::asStringView(std::string_view defaultValue) const
+    {
+        if (tag() != '\"')
+            return defaultValue;
+        return _tape->string(_pos);
+    }
+
+    TapeValue TapeValue::operator[](std::string_view key) const
+    {
+        if (tag() != '{')
+            return TapeValue();
+
+        for (Iterator i = begin(), e = end(); i != e; ++i)
+        {
+            if (i.key() == key)
+                return *i;
+        }
+        return TapeValue();
+    }
+
+    bool TapeValue::hasKey(std::string_view key) const
+    {
+        return (*this)[key]._tape != nullptr;
+    }
+
+    TapeValue TapeValue::operator[](size_t key) const
+    {
+        if (tag() != '[' || key >= size())
+            return TapeValue();
+
+        uint32_t pos = _pos + 1;
+        for (; key; --key)
+            pos = _tape->skip(pos);
+        return TapeValue(_tape, pos);
+    }
+
+    size_t TapeValue::size() const
+    {
+        uint64_t w = word();
+        char t = Tape::tagOf(w);
+        if (t != '{' && t != '[')
+            return 0;
+
+        uint32_t count = (uint32_t)(w >> 32) & Tape::countLimit;
+        if (count < Tape::countLimit)
+            return count;
+
+        size_t n = 0;
+        for (Iterator i = begin(), e = end(); i != e; ++i)
+            ++n;
+        return n;
+    }
+
+    TapeValue::Iterator TapeValue::begin() const
+    {
+        char t = tag();
+        if (t != '{' && t != '[')
+            return end();
+        return Iterator(_tape, _pos + 1, t == '{');
+    }
+
+    TapeValue::Iterator TapeValue::end() const
+    {
+        char t = tag();
+        if (t != '{' && t != '[')
+            return Iterator(_tape, _pos, false);
+
+        // закрывающее слово перед следующим значением
+        return Iterator(_tape, _tape->skip(_pos) - 1, t == '{');
+    }
+
+    Value TapeValue::toValue() const
+    {
+        switch (tag())
+        {
+        case 't':
+            return Value(true);
+        case 'f':
+            return Value(false);
+        case 'l':
+            return Value(asLongLong());
+        case 'd':
+            return Value(asNumber());
+        case '\"':
+            return Value(std::string(asStringView()));
+
+        case '[':
+        {
+            Value res = Value::createArray();
+            res.reserve(size());
+            for (TapeValue v : *this)
+                res.add(v.toValue());
+            if (res.size() >= Value::packThreshold && packArrays())
+                res.pack();
+            return res;
+        }
+
+        case '{':
+        {
+            // при повторном ключе остаётся первое значение
+            Value res = Value::createObject();
+            res.reserve(size());
+            ObjectContainer *o = res.asObject();
+            for (Iterator i = begin(), e = end(); i != e; ++i)
+            {
+                auto r = o->try_emplace(i.key());
+                if (r.second)
+                    r.first->second = (*i).toValue();
+            }
+            return res;
+        }
+
+        default:
+            return Value();
+        }
+    }
+
+} // namespace Json
@@ -0,0 +1,245 @@
+#ifndef TAPE_H
+#define TAPE_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "value.h"
+
+namespace Json
+{
+    class Tape;
+
+    /* Значение на ленте. Лёгкий курсор (указатель на ленту и номер слова)
+       с теми же методами чтения, что у Value; копируется свободно.
+       Действителен, пока жива лента и она не разобрана заново */
+    class TapeValue
+    {
+    public:
+        class Iterator;
+
+        TapeValue()
+            : _tape(nullptr), _pos(0)
+        {
+        }
+
+        Value::Type type() const;
+        bool isUndefined() const { return type() == Value::Type::UNDEFINED; }
+        bool isBoolean() const { return type() == Value::Type::BOOLEAN; }
+        bool isNumber() const { return isInteger() || isFloatingPoint(); }
+        bool isInteger() const { return type() == Value::Type::INTEGER; }
+        bool isFloatingPoint() const { return type() == Value::Type::NUMBER; }
+        bool isString() const { return type() == Value::Type::STRING; }
+        bool isArray() const { return type() == Value::Type::ARRAY; }
+        bool isObject() const { return type() == Value::Type::OBJECT; }
+
+        /* преобразования те же, что у Value */
+        bool asBoolean(bool defaultValue = false) const;
+        double asNumber(double defaultValue = 0) const;
+        long asLong(long defaultValue = 0) const;
+        long long asLongLong(long long defaultValue = 0) const;
+        int asInt(int defaultValue = 0) const;
+        std::string asString(const std::string &defaultValue = "") const;
+
+        /* строка без копирования, указывает в строковый буфер ленты */
+        std::string_view asStringView(std::string_view defaultValue = {}) const;
+
+        /* первое значение с ключом key, как в parseJson; перебор членов */
+        TapeValue operator[](std::string_view key) const;
+        bool hasKey(std::string_view key) const;
+
+        /* элемент массива; соседние значения пропускаются прыжком, O(key) */
+        TapeValue operator[](size_t key) const;
+
+        /* число элементов массива или членов объекта (повторные ключи
+           считаются, как записаны) */
+        size_t size() const;
+
+        /* обход элементов массива или членов объекта */
+        Iterator begin() const;
+        Iterator end() const;
+
+        /* дерево Value для изменения; строки копируются */
+        Value toValue() const;
+
+    private:
+        friend class Tape;
+
+        TapeValue(const Tape *tape, uint32_t pos)
+            : _tape(tape), _pos(pos)
+        {
+        }
+
+        uint64_t word() const;
+        char tag() const;
+
+        const Tape *_tape;
+        uint32_t _pos; // номер первого слова значения
+    };
+
+    /* Обход контейнера. У объекта key() — ключ текущего члена, у массива пустая строка */
+    class TapeValue::Iterator
+    {
+    public:
+        TapeValue operator*() const;
+        std::string_view key() const;
+
+        Iterator &operator++();
+        bool operator==(const Iterator &i) const { return _pos == i._pos; }
+        bool operator!=(const Iterator &i) const { return _pos != i._pos; }
+
+    private:
+        friend class TapeValue;
+
+        Iterator(const Tape *tape, uint32_t pos, bool object)
+            : _tape(tape), _pos(pos), _object(object)
+        {
+        }
+
+        const Tape *_tape;
+        uint32_t _pos; // у объекта — слово ключа
+        bool _object;
+    };
+
+    /* Разобранный документ только для чтения в виде ленты: все значения
+       подряд в одном массиве 64-битных слов, строки и ключи — в отдельном
+       буфере. Обход идёт по памяти последовательно, без переходов по
+       указателям; поддеревья пропускаются по смещению, записанному в
+       открывающем слове контейнера.
+
+       Слово: старший байт — тег, остальные 56 бит — данные.
+           'n' 't' 'f'    null, true, false
+           'l' 'd'        целое и число с плавающей точкой, значение в следующем слове
+           '"'            строка или ключ, данные — смещение в буфере строк,
+                          где лежат длина (uint32_t), байты и '\0'
+           '{' '['        младшие 32 бита — номер слова за парной скобкой,
+                          следующие 24 — число элементов (0xFFFFFF — не меньше)
+           '}' ']'        номер открывающего слова
+       Член объекта — слово ключа и следом значение.
+
+       Входной буфер после разбора не нужен. Грамматика та же, что у
+       parseJson, повторные ключи на ленте сохраняются */
+    class Tape
+    {
+    public:
+        Tape();
+
+        Tape(const Tape &) = delete;
+        Tape &operator=(const Tape &) = delete;
+
+        /* разбирает data..end, память предыдущего разбора используется повторно */
+        TapeValue parse(const char *data, const char *end);
+        TapeValue parse(const char *data);
+
+        /* разбирает файл. При ошибке возвращает false, описание — в error() */
+        bool parseFile(const char *fileName);
+        const std::string &error() const { return _error; }
+
+        TapeValue root() const { return TapeValue(this, 0); }
+
+        /* число слов ленты и байт в буфере строк */
+        size_t words() const { return _words.size(); }
+        size_t stringBytes() const { return _strings.size(); }
+
+    private:
+        friend class TapeValue;
+        friend class TapeBuilder;
+
+        static const uint64_t payloadMask = (1ULL << 56) - 1;
+        static const uint32_t countLimit = 0xFFFFFF;
+
+        static uint64_t makeWord(char tag, uint64_t payload) { return ((uint64_t)(unsigned char)tag << 56) | payload; }
+        static char tagOf(uint64_t w) { return (char)(w >> 56); }
+
+        /* слово сразу за значением, начинающимся с pos */
+        uint32_t skip(uint32_t pos) const;
+
+        std::string_view string(uint32_t pos) const;
+
+        std::vector<uint64_t> _words;
+        std::vector<char> _strings;
+        std::string _error;
+    };
+
+    ////////////////////////////////////////////////////////////////////////////////
+    //
+    //  Обход ленты встраивается: на каждый узел приходится несколько вызовов
+    //
+    inline uint32_t Tape::skip(uint32_t pos) const
+    {
+        uint64_t w = _words[pos];
+        switch (tagOf(w))
+        {
+        case '{':
+        case '[':
+            return (uint32_t)w;
+        case 'l':
+        case 'd':
+            return pos + 2;
+        default:
+            return pos + 1;
+        }
+    }
+
+    inline std::string_view Tape::string(uint32_t pos) const
+    {
+        const char *p = &_strings[_words[pos] & payloadMask];
+        uint32_t n;
+        memcpy(&n, p, sizeof(n));
+        return std::string_view(p + sizeof(n), n);
+    }
+
+    inline uint64_t TapeValue::word() const
+    {
+        return _tape ? _tape->_words[_pos] : Tape::makeWord('n', 0);
+    }
+
+    inline char TapeValue::tag() const
+    {
+        return Tape::tagOf(word());
+    }
+
+    inline Value::Type TapeValue::type() const
+    {
+        switch (tag())
+        {
+        case 't':
+        case 'f':
+            return Value::Type::BOOLEAN;
+        case 'l':
+            return Value::Type::INTEGER;
+        case 'd':
+            return Value::Type::NUMBER;
+        case '\"':
+            return Value::Type::STRING;
+        case '[':
+            return Value::Type::ARRAY;
+        case '{':
+            return Value::Type::OBJECT;
+        default:
+            return Value::Type::UNDEFINED;
+        }
+    }
+
+    inline TapeValue TapeValue::Iterator::operator*() const
+    {
+        return TapeValue(_tape, _object ? _pos + 1 : _pos);
+    }
+
+    inline std::string_view TapeValue::Iterator::key() const
+    {
+        return _object ? _tape->string(_pos) : std::string_view();
+    }
+
+    inline TapeValue::Iterator &TapeValue::Iterator::operator++()
+    {
+        _pos = _tape->skip(_object ? _pos + 1 : _pos);
+        return *this;
+    }
+
+} // namespace Json
+
+#endif // TAPE_H
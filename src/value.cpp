@@ -1,216 +1,302 @@
+#include <algorithm>
+#include <atomic>
 #include <charconv>
+#include <climits>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
 #include <float.h>
 #include <ostream>
-
+#include <stdexcept>
+
+#include "document.h"
+#include "escape.h"
+#include "mappedfile.h"
+#include "number.h"
+#include "parser.h"
+#include "sax.h"
+#include "streamwriter.h"
+#include "structural.h"
 #include "value.h"
+#include "valuebuilder.h"
 
 namespace Json
 {
     std::string numberToString(double v)
     {
-        // проверка на NaN
-        if (!(v == v))
-            return "null";
+        std::string s;
+        return numberto(s, v);
+    }
 
-        // проверка на inf
-        if (!((v <= DBL_MAX) && (v >= -DBL_MAX)))
-            return "null";
+    std::string numberToString(long long v)
+    {
+        std::string s;
+        return numberto(s, v);
+    }
 
-        // проверка на ноль
-        if (v == 0)
-            return std::signbit(v) ? "-0.0" : "0.0";
+    static void escapestringto(std::string &buff, std::string_view v)
+    {
+        size_t n = buff.size();
+        buff.resize(n + escapedSize(v));
+        escapeTo(&buff[n], v);
+    }
 
-        int exp = floor(log10(fabs(v)));
+    std::string escapedString(const std::string &s)
+    {
+        std::string es;
+        escapestringto(es, s);
+        return es;
+    }
 
-        if (exp > 8 || exp < -8)
-        {
-            char buf[32];
-            int n = snprintf(buf, 31, "%.16e", v);
-            return std::string(buf, n);
-        }
-        else
+    static bool hex4(const char *v, uint32_t &ch)
+    {
+        ch = 0;
+        for (int i = 0; i < 4; ++i)
         {
-            std::string s = std::to_string(v);
-            while (s.size() > 2)
-            {
-                if (s[s.size() - 2] != '.' && s[s.size() - 1] == '0')
-                {
-                    s.resize(s.size() - 1);
-                }
-                else
-                {
-                    break;
-                }
-            }
-            return s;
+            char c = v[i];
+            ch <<= 4;
+            if (c >= '0' && c <= '9')
+                ch |= c - '0';
+            else if (c >= 'a' && c <= 'f')
+                ch |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F')
+                ch |= c - 'A' + 10;
+            else
+                return false;
         }
+        return true;
     }
 
-    std::string numberToString(long long v)
+    static char *utf8to(char *out, uint32_t ch)
     {
-        return std::to_string(v);
+        if (ch < 0x80)
+        {
+            *out++ = (char)ch;
+        }
+        else if (ch < 0x800)
+        {
+            *out++ = (char)((ch >> 6) | 0xC0);
+            *out++ = (char)((ch & 0x3F) | 0x80);
+        }
+        else if (ch < 0x10000)
+        {
+            *out++ = (char)((ch >> 12) | 0xE0);
+            *out++ = (char)(((ch >> 6) & 0x3F) | 0x80);
+            *out++ = (char)((ch & 0x3F) | 0x80);
+        }
+        else if (ch < 0x110000)
+        {
+            *out++ = (char)((ch >> 18) | 0xF0);
+            *out++ = (char)(((ch >> 12) & 0x3F) | 0x80);
+            *out++ = (char)(((ch >> 6) & 0x3F) | 0x80);
+            *out++ = (char)((ch & 0x3F) | 0x80);
+        }
+        return out;
     }
 
-    static void escapestringto(std::string &buff, const std::string &v)
+    /* раскрывает escape-последовательности v в buff, где места не меньше size;
+       возвращает длину результата */
+    size_t unescapestringto(char *buff, const char *v, size_t size)
     {
-        int pc = -1;
-        for (auto &c : v)
+        char *out = buff;
+        const char *pe = v + size;
+        while (v < pe)
         {
-            switch (c)
+            const char *bs = (const char *)memchr(v, '\\', pe - v);
+            if (bs == nullptr)
             {
-            case '\b':
-            case '\f':
-            case '\n':
-            case '\r':
-            case '\t':
-                buff.push_back('\\');
-                buff.push_back(c);
+                memcpy(out, v, pe - v);
+                out += pe - v;
                 break;
+            }
+
+            memcpy(out, v, bs - v);
+            out += bs - v;
+            v = bs + 1;
 
+            // одиночная '\\' в конце отбрасывается
+            if (v == pe)
+                break;
+
+            char c = *v++;
+            switch (c)
+            {
             case '\"':
             case '\\':
             case '/':
-                if (pc == '\\')
+                *out++ = c;
+                break;
+
+            case 'b':
+                *out++ = '\b';
+                break;
+            case 'f':
+                *out++ = '\f';
+                break;
+            case 'n':
+                *out++ = '\n';
+                break;
+            case 'r':
+                *out++ = '\r';
+                break;
+            case 't':
+                *out++ = '\t';
+                break;
+
+            case 'u':
+            {
+                uint32_t ch;
+                if (pe - v < 4 || !hex4(v, ch))
                 {
-                    buff.push_back(c);
+                    *out++ = '\\';
+                    *out++ = c;
+                    break;
                 }
-                else
+                v += 4;
+
+                // surrogate pair
+                uint32_t ch2;
+                if (ch >= 0xD800 && ch <= 0xDBFF && pe - v >= 6 && v[0] == '\\' && v[1] == 'u' && hex4(v + 2, ch2))
                 {
-                    buff.push_back('\\');
-                    buff.push_back(c);
+                    ch = (ch - 0xD800) * 0x400 + (ch2 - 0xDC00) + 0x10000;
+                    v += 6;
                 }
-                break;
+                out = utf8to(out, ch);
+            }
+            break;
 
             default:
-                buff.push_back(c);
+                *out++ = '\\';
+                *out++ = c;
                 break;
             }
-            pc = c;
         }
+        return out - buff;
     }
 
-    std::string escapedString(const std::string &s)
+    template <class String>
+    static void unescapestringto(String &buff, const char *v, size_t size)
     {
-        std::string es;
-        escapestringto(es, s);
-        return es;
+        size_t n = buff.size();
+        buff.resize(n + size);
+        buff.resize(n + unescapestringto(&buff[n], v, size));
     }
 
-    static void unescapestringto(std::string &buff, const char *v, size_t size)
+    // Значения помнят ресурс в 48 битах адреса (см. Value::bind), поэтому
+    // ресурс с адресом старше отвергается сразу, когда попадает в значение,
+    // а не теряется потом. Ресурс по умолчанию значения не запоминают
+    static void checkResource(std::pmr::memory_resource *r)
     {
-        int pc = -1;
-        char c;
-        const char *pb = 0;
-        for (const char *pe = v + size; c = *v, v < pe;)
+        if (((uint64_t)(uintptr_t)r >> 48) && r != std::pmr::get_default_resource())
+            throw std::invalid_argument("Json::Value: memory resource address does not fit in 48 bits");
+    }
+
+    // контейнер T(args..., r) в ресурсе r; если конструктор бросает
+    // (кончилась память ограниченного ресурса), память возвращается
+    template <class T, class... Args>
+    static T *createContainer(std::pmr::memory_resource *r, Args &&...args)
+    {
+        checkResource(r);
+        void *p = r->allocate(sizeof(T), alignof(T));
+        try
         {
-            if (pc == '\\')
-            {
-                pc = -1;
-                switch (c)
-                {
-                case '\"':
-                case '\\':
-                case '/':
-                    buff.push_back(c);
-                    break;
+            return new (p) T(std::forward<Args>(args)..., r);
+        }
+        catch (...)
+        {
+            r->deallocate(p, sizeof(T), alignof(T));
+            throw;
+        }
+    }
 
-                case 'b':
-                    buff.push_back('\b');
-                    break;
-                case 'f':
-                    buff.push_back('\f');
-                    break;
-                case 'n':
-                    buff.push_back('\n');
-                    break;
-                case 'r':
-                    buff.push_back('\r');
-                    break;
-                case 't':
-                    buff.push_back('\t');
-                    break;
-                case 'u':
-                {
-                    char *ec = (char *)(v + 1);
-                    u_int32_t ch = strtol(ec, &ec, 16);
-                    if (ch < 0x80)
-                    {
-                        buff.push_back((char)ch);
-                    }
-                    else if (ch < 0x800)
-                    {
-                        buff.push_back((ch >> 6) | 0xC0);
-                        buff.push_back((ch & 0x3F) | 0x80);
-                    }
-                    else if (ch < 0x10000)
-                    {
-                        if (ch >= 0xD800 && ch <= 0xDBFF)
-                        {
-                            // surrogate pair
-                            if (*ec == '\\' && *(ec + 1) == 'u')
-                            {
-                                char *ec2 = (char *)(ec + 2);
-                                u_int32_t ch2 = strtol(ec2, &ec2, 16);
-
-                                ch = (ch - 0xD800) * 0x400;
-                                ch2 = (ch2 - 0xDC00);
-
-                                ch = ch + ch2 + 0x10000;
-
-                                buff.push_back((ch >> 18) | 0xF0);
-                                buff.push_back(((ch >> 12) & 0x3F) | 0x80);
-                                buff.push_back(((ch >> 6) & 0x3F) | 0x80);
-                                buff.push_back((ch & 0x3F) | 0x80);
-
-                                v = ec2;
-                                continue;
-                            }
-                        }
-                        {
-                            buff.push_back((ch >> 12) | 0xE0);
-                            buff.push_back(((ch >> 6) & 0x3F) | 0x80);
-                            buff.push_back((ch & 0x3F) | 0x80);
-                        }
-                    }
-                    else if (ch < 0x110000)
-                    {
-                        buff.push_back((ch >> 18) | 0xF0);
-                        buff.push_back(((ch >> 12) & 0x3F) | 0x80);
-                        buff.push_back(((ch >> 6) & 0x3F) | 0x80);
-                        buff.push_back((ch & 0x3F) | 0x80);
-                    }
-                    v = ec;
-                    continue;
-                }
-                break;
+    template <class T>
+    static T *copyContainer(const T &c, std::pmr::memory_resource *r)
+    {
+        return createContainer<T>(r, c);
+    }
 
-                default:
-                    buff.push_back(pc);
-                    buff.push_back(c);
-                    break;
-                }
-            }
-            else if (c == '\\')
-            {
-                if (pb)
-                {
-                    buff.append(pb, v);
-                    pb = 0;
-                }
-                pc = c;
-            }
-            else if (pb == 0)
-            {
-                pb = v;
-            }
-            ++v;
+    template <class T>
+    static void destroyContainer(T *c)
+    {
+        std::pmr::memory_resource *r = c->get_allocator().resource();
+        c->~T();
+        r->deallocate(c, sizeof(T), alignof(T));
+    }
+
+    // строка в ресурсе памяти: заголовок, capacity байт и '\0'
+    struct AllocatedHeader
+    {
+        std::pmr::memory_resource *resource;
+        size_t capacity;
+    };
+
+    static AllocatedHeader *allocatedHeader(const char *s)
+    {
+        return (AllocatedHeader *)(s - sizeof(AllocatedHeader));
+    }
+
+    static void freeAllocated(const char *s)
+    {
+        AllocatedHeader *h = allocatedHeader(s);
+        h->resource->deallocate(h, sizeof(AllocatedHeader) + h->capacity + 1, alignof(AllocatedHeader));
+    }
+
+    // счётчик ссылок разделяемого содержимого лежит непосредственно перед ним
+    static const size_t sharedHeaderSize = alignof(std::max_align_t);
+    static std::atomic<bool> copyOnWriteEnabled(false);
+    static std::atomic<bool> packArraysEnabled(false);
+
+    static std::atomic<uint32_t> &sharedRefs(const void *payload)
+    {
+        return *(std::atomic<uint32_t> *)((char *)payload - sharedHeaderSize);
+    }
+
+    template <class T, class... Args>
+    static T *createShared(Args &&...args)
+    {
+        char *p = (char *)::operator new(sharedHeaderSize + sizeof(T));
+        new (p) std::atomic<uint32_t>(1);
+        try
+        {
+            return new (p + sharedHeaderSize) T(std::forward<Args>(args)...);
         }
-        if (pb)
+        catch (...)
         {
-            buff.append(pb, v);
+            ::operator delete(p);
+            throw;
         }
     }
 
+    template <class T>
+    static void releaseShared(T *payload)
+    {
+        if (sharedRefs(payload).fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            payload->~T();
+            ::operator delete((char *)payload - sharedHeaderSize);
+        }
+    }
+
+    void setCopyOnWrite(bool enable)
+    {
+        copyOnWriteEnabled.store(enable, std::memory_order_relaxed);
+    }
+
+    bool copyOnWrite()
+    {
+        return copyOnWriteEnabled.load(std::memory_order_relaxed);
+    }
+
+    void setPackArrays(bool enable)
+    {
+        packArraysEnabled.store(enable, std::memory_order_relaxed);
+    }
+
+    bool packArrays()
+    {
+        return packArraysEnabled.load(std::memory_order_relaxed);
+    }
+
     //////////////////////////////////////////////////////////////////////////////
     //
     //
@@ -224,6 +310,12 @@ namespace Json
     {
     }
 
+    Value::Value(std::pmr::memory_resource *r) : _type(Type::UNDEFINED)
+    {
+        checkResource(r);
+        bind(r == std::pmr::get_default_resource() ? nullptr : r);
+    }
+
     Value::Value(bool v) : _type(Type::BOOLEAN)
     {
         _value._l = v;
@@ -264,93 +356,573 @@ namespace Json
             _type = Type::UNDEFINED;
             return;
         }
-
-        _value._d = v;
+
+        _value._d = v;
+    }
+
+    Value::Value(const char *v) : _type(Type::STRING)
+    {
+        setString(v);
+    }
+
+    Value::Value(const std::string &v) : _type(Type::STRING)
+    {
+        setString(v);
+    }
+
+    Value::Value(std::string &&v) : _type(Type::STRING)
+    {
+        if (v.size() <= inlineCapacity)
+        {
+            setString(v);
+        }
+        else if (copyOnWrite())
+        {
+            _value._s = createShared<std::string>(std::move(v));
+            _kind = SHARED;
+        }
+        else
+        {
+            _value._s = new std::string(std::move(v));
+        }
+    }
+
+    Value::Value(std::initializer_list<std::pair<std::string, Value>> v)
+        : Value(createObject())
+    {
+        for (auto &p : v)
+            _value._o->emplace(p.first, p.second);
+    }
+
+    Value Value::createArray()
+    {
+        return createArray(std::pmr::get_default_resource());
+    }
+
+    Value Value::createObject()
+    {
+        return createObject(std::pmr::get_default_resource());
+    }
+
+    Value Value::createArray(std::pmr::memory_resource *r)
+    {
+        // тип ставится после выделения: при нехватке памяти деструктору
+        // нечего освобождать
+        Value v;
+        if (r == std::pmr::get_default_resource() && copyOnWrite())
+        {
+            v._value._a = createShared<ArrayContainer>(r);
+            v._kind = SHARED;
+        }
+        else
+        {
+            v._value._a = createContainer<ArrayContainer>(r);
+        }
+        v._type = Type::ARRAY;
+        return v;
+    }
+
+    Value Value::createObject(std::pmr::memory_resource *r)
+    {
+        // тип ставится после выделения: при нехватке памяти деструктору
+        // нечего освобождать
+        Value v;
+        if (r == std::pmr::get_default_resource() && copyOnWrite())
+        {
+            v._value._o = createShared<ObjectContainer>(r);
+            v._kind = SHARED;
+        }
+        else
+        {
+            v._value._o = createContainer<ObjectContainer>(r);
+        }
+        v._type = Type::OBJECT;
+        return v;
+    }
+
+    Value Value::createString(std::string_view s, std::pmr::memory_resource *r)
+    {
+        Value v;
+        v.setString(s, r);
+        v._type = Type::STRING;
+        return v;
+    }
+
+    Value Value::view(const char *data, size_t size)
+    {
+        Value v;
+        v._type = Type::STRING;
+        v._kind = VIEW;
+        v._value._v = data;
+        v._size = (uint32_t)size;
+        return v;
+    }
+
+    void Value::setString(std::string_view s)
+    {
+        static_assert(offsetof(Value, _size) == sizeof(_Value) &&
+                          offsetof(Value, _owner) + sizeof(_owner) == inlineCapacity &&
+                          offsetof(Value, _kind) == inlineCapacity,
+                      "inline string must fit before _kind");
+
+        if (s.size() <= inlineCapacity)
+        {
+            memcpy(reinterpret_cast<char *>(&_value), s.data(), s.size());
+            _kind = (Kind)(INLINE + s.size());
+        }
+        else if (copyOnWrite())
+        {
+            _value._s = createShared<std::string>(s);
+            _kind = SHARED;
+        }
+        else
+        {
+            _value._s = new std::string(s);
+            _kind = OWNED;
+        }
+    }
+
+    // в ресурсе по умолчанию строка создаётся как обычно, в другом ресурсе
+    // выделяется и короткая: так значение помнит ресурс
+    void Value::setString(std::string_view s, std::pmr::memory_resource *r)
+    {
+        if (r == std::pmr::get_default_resource() || s.size() > UINT32_MAX)
+        {
+            setString(s);
+            return;
+        }
+
+        checkResource(r);
+        AllocatedHeader *h = (AllocatedHeader *)r->allocate(sizeof(AllocatedHeader) + s.size() + 1, alignof(AllocatedHeader));
+        h->resource = r;
+        h->capacity = s.size();
+        char *p = (char *)(h + 1);
+        memcpy(p, s.data(), s.size());
+        p[s.size()] = 0;
+
+        _value._v = p;
+        _size = (uint32_t)s.size();
+        _kind = ALLOCATED;
+    }
+
+    std::pmr::memory_resource *Value::allocationResource() const
+    {
+        switch (_type)
+        {
+        case Type::OBJECT:
+            return _kind == SHARED ? std::pmr::get_default_resource() : _value._o->get_allocator().resource();
+
+        case Type::ARRAY:
+            if (_kind == SHARED)
+                return std::pmr::get_default_resource();
+            if (_kind == PACKED_NUMBER)
+                return _value._na->get_allocator().resource();
+            if (_kind == PACKED_INTEGER)
+                return _value._ia->get_allocator().resource();
+            return _value._a->get_allocator().resource();
+
+        case Type::STRING:
+            if (_kind == OWNED || _kind == SHARED)
+                return std::pmr::get_default_resource();
+            if (_kind == ALLOCATED)
+                return allocatedHeader(_value._v)->resource;
+            return nullptr;
+
+        default:
+            return nullptr;
+        }
+    }
+
+    std::pmr::memory_resource *Value::boundResource() const
+    {
+        switch (_type)
+        {
+        case Type::UNDEFINED:
+        case Type::BOOLEAN:
+        case Type::INTEGER:
+        case Type::NUMBER:
+            return binding();
+        default:
+            break;
+        }
+
+        std::pmr::memory_resource *r = allocationResource();
+        return r == std::pmr::get_default_resource() ? nullptr : r;
+    }
+
+    std::pmr::memory_resource *Value::resource() const
+    {
+        std::pmr::memory_resource *r = boundResource();
+        return r ? r : std::pmr::get_default_resource();
+    }
+
+    void Value::detach()
+    {
+        if (_kind != SHARED || sharedRefs(_value._o).load(std::memory_order_acquire) == 1)
+            return;
+
+        std::pmr::memory_resource *r = std::pmr::get_default_resource();
+        switch (_type)
+        {
+        case Type::OBJECT:
+        {
+            ObjectContainer *c = createShared<ObjectContainer>(*_value._o, r);
+            releaseShared(_value._o);
+            _value._o = c;
+        }
+        break;
+
+        case Type::ARRAY:
+        {
+            ArrayContainer *c = createShared<ArrayContainer>(*_value._a, r);
+            releaseShared(_value._a);
+            _value._a = c;
+        }
+        break;
+
+        default:
+            break;
+        }
+    }
+
+    std::string_view Value::stringView() const
+    {
+        if (_kind >= INLINE)
+            return std::string_view(reinterpret_cast<const char *>(&_value), _kind - INLINE);
+        if (_kind == VIEW || _kind == ALLOCATED)
+            return std::string_view(_value._v, _size);
+        return *_value._s;
+    }
+
+    bool Value::pack()
+    {
+        if (_type != Type::ARRAY)
+            return false;
+        if (isPacked())
+            return true;
+
+        const ArrayContainer &a = *_value._a;
+        if (a.empty())
+            return false;
+
+        Type t = a[0]._type;
+        if (t != Type::NUMBER && t != Type::INTEGER)
+            return false;
+        for (const Value &e : a)
+        {
+            if (e._type != t)
+                return false;
+        }
+
+        // разделяемый массив остаётся другим владельцам, упакованный — в ресурсе по умолчанию
+        std::pmr::memory_resource *r = _kind == SHARED ? std::pmr::get_default_resource() : a.get_allocator().resource();
+        size_t n = a.size();
+
+        if (t == Type::NUMBER)
+        {
+            NumberContainer *c = createContainer<NumberContainer>(r, n);
+            for (size_t i = 0; i < n; ++i)
+                (*c)[i] = a[i]._value._d;
+            reset();
+            _value._na = c;
+            _kind = PACKED_NUMBER;
+        }
+        else
+        {
+            IntegerContainer *c = createContainer<IntegerContainer>(r, n);
+            for (size_t i = 0; i < n; ++i)
+                (*c)[i] = a[i]._value._i;
+            reset();
+            _value._ia = c;
+            _kind = PACKED_INTEGER;
+        }
+        _type = Type::ARRAY;
+        return true;
+    }
+
+    void Value::unpack()
+    {
+        if (!isPacked())
+            return;
+
+        Value res;
+        if (_kind == PACKED_NUMBER)
+        {
+            res = createArray(_value._na->get_allocator().resource());
+            res._value._a->reserve(_value._na->size());
+            for (double d : *_value._na)
+                res._value._a->emplace_back(d);
+        }
+        else
+        {
+            res = createArray(_value._ia->get_allocator().resource());
+            res._value._a->reserve(_value._ia->size());
+            for (int64_t i : *_value._ia)
+                res._value._a->emplace_back((long long)i);
+        }
+
+        // элементы запоминают ресурс массива
+        if (std::pmr::memory_resource *r = boundResource())
+        {
+            for (Value &e : *res._value._a)
+                e.bind(r);
+        }
+        *this = std::move(res);
+    }
+
+    const ArrayContainer &Value::packedElements() const
+    {
+        std::atomic<ArrayContainer *> &slot = _kind == PACKED_NUMBER ? _value._na->_elements : _value._ia->_elements;
+        ArrayContainer *e = slot.load(std::memory_order_acquire);
+        if (e)
+            return *e;
+
+        // поток, опоздавший с публикацией, освобождает свою копию
+        ArrayContainer *c;
+        if (_kind == PACKED_NUMBER)
+        {
+            c = createContainer<ArrayContainer>(_value._na->get_allocator().resource());
+            try
+            {
+                c->reserve(_value._na->size());
+            }
+            catch (...)
+            {
+                destroyContainer(c);
+                throw;
+            }
+            for (double d : *_value._na)
+                c->emplace_back(d);
+        }
+        else
+        {
+            c = createContainer<ArrayContainer>(_value._ia->get_allocator().resource());
+            try
+            {
+                c->reserve(_value._ia->size());
+            }
+            catch (...)
+            {
+                destroyContainer(c);
+                throw;
+            }
+            for (int64_t i : *_value._ia)
+                c->emplace_back((long long)i);
+        }
+
+        if (slot.compare_exchange_strong(e, c, std::memory_order_acq_rel, std::memory_order_acquire))
+            return *c;
+        destroyContainer(c);
+        return *e;
+    }
+
+    void Value::dropPackedElements()
+    {
+        std::atomic<ArrayContainer *> &slot = _kind == PACKED_NUMBER ? _value._na->_elements : _value._ia->_elements;
+        if (ArrayContainer *e = slot.exchange(nullptr, std::memory_order_acq_rel))
+            destroyContainer(e);
+    }
+
+    bool Value::equalElements(const Value &v) const
+    {
+        size_t n = size();
+        if (n != v.size())
+            return false;
+
+        auto packedAt = [](const Value &a, size_t i) {
+            return a._kind == PACKED_NUMBER ? Value((*a._value._na)[i]) : Value((long long)(*a._value._ia)[i]);
+        };
+
+        // сравнение несимметрично (см. operator==), порядок сохраняется
+        for (size_t i = 0; i < n; ++i)
+        {
+            bool eq;
+            if (isPacked() && v.isPacked())
+                eq = packedAt(*this, i) == packedAt(v, i);
+            else if (isPacked())
+                eq = packedAt(*this, i) == (*v._value._a)[i];
+            else
+                eq = (*_value._a)[i] == packedAt(v, i);
+            if (!eq)
+                return false;
+        }
+        return true;
     }
 
-    Value::Value(const char *v) : _type(Type::STRING)
+    void Value::append(const Value &v)
     {
-        _value._s = new std::string(v);
-    }
+        if (isPacked())
+            dropPackedElements();
 
-    Value::Value(const std::string &v) : _type(Type::STRING)
-    {
-        _value._s = new std::string(v);
+        if (_kind == PACKED_NUMBER && v._type == Type::NUMBER)
+            _value._na->push_back(v._value._d);
+        else if (_kind == PACKED_INTEGER && v._type == Type::INTEGER)
+            _value._ia->push_back(v._value._i);
+        else
+            add(v);
     }
 
-    Value::Value(std::string &&v) : _type(Type::STRING)
+    const double *Value::packedNumbers() const
     {
-        _value._s = new std::string(std::move(v));
+        return _kind == PACKED_NUMBER ? _value._na->data() : nullptr;
     }
 
-    Value Value::createArray()
+    const int64_t *Value::packedIntegers() const
     {
-        Value v;
-        v._type = Type::ARRAY;
-        v._value._a = new ArrayContainer;
-        return v;
+        return _kind == PACKED_INTEGER ? _value._ia->data() : nullptr;
     }
 
-    Value Value::createObject()
+    // пустое значение остаётся в ресурсе прежнего содержимого
+    void Value::reset()
     {
-        Value v;
-        v._type = Type::OBJECT;
-        v._value._o = new ObjectContainer;
-        return v;
+        std::pmr::memory_resource *r = boundResource();
+        destroy();
+        _type = Type::UNDEFINED;
+        _kind = OWNED;
+        bind(r);
     }
 
-    void Value::reset()
+    void Value::destroy()
     {
         switch (_type)
         {
         case Type::OBJECT:
-            delete _value._o;
+            if (_kind == SHARED)
+                releaseShared(_value._o);
+            else
+                destroyContainer(_value._o);
             break;
 
         case Type::ARRAY:
-            delete _value._a;
+            if (_kind == SHARED)
+                releaseShared(_value._a);
+            else if (isPacked())
+            {
+                dropPackedElements();
+                if (_kind == PACKED_NUMBER)
+                    destroyContainer(_value._na);
+                else
+                    destroyContainer(_value._ia);
+            }
+            else
+                destroyContainer(_value._a);
             break;
 
         case Type::STRING:
-            delete _value._s;
+            if (_kind == OWNED)
+                delete _value._s;
+            else if (_kind == SHARED)
+                releaseShared(_value._s);
+            else if (_kind == ALLOCATED)
+                freeAllocated(_value._v);
             break;
 
         default:
             break;
         }
-        _type = Type::UNDEFINED;
     }
 
     Value::~Value()
     {
-        reset();
+        destroy();
     }
 
     Value::Value(const Value &v) : _type(v._type)
     {
+        copyFrom(v, std::pmr::get_default_resource());
+    }
+
+    Value::Value(const Value &v, std::pmr::memory_resource *r) : _type(v._type)
+    {
+        copyFrom(v, r);
+    }
+
+    // в ресурсе по умолчанию разделяемое содержимое не копируется, остальное
+    // копируется в r; вложенные значения чужого ресурса копируются тоже
+    void Value::copyFrom(const Value &v, std::pmr::memory_resource *r)
+    {
+        bool heap = r == std::pmr::get_default_resource();
+        if (v._kind == SHARED && heap)
+        {
+            sharedRefs(v._value._o).fetch_add(1, std::memory_order_relaxed);
+            _value = v._value;
+            _kind = SHARED;
+            return;
+        }
+
         switch (_type)
         {
         case Type::OBJECT:
-            _value._o = new ObjectContainer(*v._value._o);
+            if (heap && copyOnWrite())
+            {
+                _value._o = createShared<ObjectContainer>(*v._value._o, r);
+                _kind = SHARED;
+            }
+            else
+            {
+                _value._o = copyContainer(*v._value._o, r);
+            }
             break;
 
         case Type::ARRAY:
-            _value._a = new ArrayContainer(*v._value._a);
+            if (v._kind == PACKED_NUMBER)
+            {
+                _value._na = copyContainer(*v._value._na, r);
+                _kind = PACKED_NUMBER;
+            }
+            else if (v._kind == PACKED_INTEGER)
+            {
+                _value._ia = copyContainer(*v._value._ia, r);
+                _kind = PACKED_INTEGER;
+            }
+            else if (heap && copyOnWrite())
+            {
+                _value._a = createShared<ArrayContainer>(*v._value._a, r);
+                _kind = SHARED;
+            }
+            else if (heap)
+            {
+                _value._a = copyContainer(*v._value._a, r);
+            }
+            else
+            {
+                // копия вектора копировала бы элементы в ресурс по умолчанию;
+                // деструктор недостроенного значения не вызывается, поэтому
+                // при нехватке памяти контейнер освобождается здесь
+                ArrayContainer *c = createContainer<ArrayContainer>(r);
+                try
+                {
+                    c->reserve(v._value._a->size());
+                    for (const Value &e : *v._value._a)
+                        c->emplace_back(e, r);
+                }
+                catch (...)
+                {
+                    destroyContainer(c);
+                    throw;
+                }
+                _value._a = c;
+            }
             break;
 
         case Type::STRING:
-            _value._s = new std::string(*v._value._s);
+            setString(v.stringView(), r);
             break;
 
         default:
+            checkResource(r);
             _value = v._value;
+            bind(heap ? nullptr : r);
             break;
         }
     }
 
-    Value::Value(Value &&v) noexcept : _type(v._type), _value(v._value)
+    Value::Value(Value &&v) noexcept
+        : _value(v._value), _size(v._size), _owner(v._owner), _kind(v._kind), _type(v._type)
     {
         v._type = Type::UNDEFINED;
+        v._kind = OWNED;
+        v.bind(nullptr);
     }
 
     Value &Value::operator=(const Value &v)
@@ -358,49 +930,61 @@ namespace Json
         if (&v == this)
             return *this;
 
-        Type savedType = v._type;
-        _Value savedValue;
-
-        switch (savedType)
-        {
-        case Type::OBJECT:
-            savedValue._o = new ObjectContainer(*v._value._o);
-            break;
+        // копия строится до reset(): v может лежать внутри этого значения
+        std::pmr::memory_resource *r = boundResource();
+        Value copy(v, r ? r : std::pmr::get_default_resource());
+        steal(copy, r);
+        return *this;
+    }
 
-        case Type::ARRAY:
-            savedValue._a = new ArrayContainer(*v._value._a);
-            break;
+    Value &Value::operator=(Value &&v) noexcept
+    {
+        if (&v != this)
+            steal(v, boundResource());
+        return *this;
+    }
 
-        case Type::STRING:
-            savedValue._s = new std::string(*v._value._s);
-            break;
+    Value &Value::assign(Value &&v)
+    {
+        if (&v == this)
+            return *this;
 
-        default:
-            savedValue = v._value;
-            break;
+        // строки и контейнеры из другого ресурса копируются в ресурс этого
+        // значения, строки документа остаются в его памяти
+        std::pmr::memory_resource *r = boundResource();
+        if (r)
+        {
+            std::pmr::memory_resource *from = v.allocationResource();
+            if (from ? from != r : v._type == Type::STRING && v._kind >= INLINE)
+            {
+                Value copy(v, r);
+                v.reset();
+                steal(copy, r);
+                return *this;
+            }
         }
 
-        reset();
-
-        _type = savedType;
-        _value = savedValue;
-
+        steal(v, r);
         return *this;
     }
 
-    Value &Value::operator=(Value &&v) noexcept
+    void Value::steal(Value &v, std::pmr::memory_resource *r)
     {
-        if (&v == this)
-            return *this;
-
-        reset();
+        destroy();
 
         _type = v._type;
         _value = v._value;
+        _size = v._size;
+        _owner = v._owner;
+        _kind = v._kind;
 
-        v._type = Type::UNDEFINED;
+        // пустое значение и скаляр хранят ресурс в себе
+        if (_type < Type::STRING)
+            bind(r);
 
-        return *this;
+        v._type = Type::UNDEFINED;
+        v._kind = OWNED;
+        v.bind(nullptr);
     }
 
     bool Value::asBoolean(bool defaultValue) const
@@ -410,7 +994,7 @@ namespace Json
         case Type::BOOLEAN:
             return _value._l;
         case Type::STRING:
-            return !_value._s->empty();
+            return !stringView().empty();
         case Type::INTEGER:
             return _value._i != 0;
         case Type::NUMBER:
@@ -423,9 +1007,21 @@ namespace Json
         }
     }
 
+    // число в начале строки, как у strtod: ведущие пробелы пропускаются
+    static Number stringToNumber(std::string_view s)
+    {
+        const char *p = s.data();
+        const char *end = p + s.size();
+        while (p < end && isspace((unsigned char)*p))
+            ++p;
+
+        Number n;
+        readNumber(p, end, n);
+        return n;
+    }
+
     double Value::asNumber(double defaultValue) const
     {
-        char *p = 0;
         switch (_type)
         {
         case Type::BOOLEAN:
@@ -435,7 +1031,10 @@ namespace Json
         case Type::NUMBER:
             return _value._d;
         case Type::STRING:
-            return strtod(_value._s->c_str(), &p);
+        {
+            Number n = stringToNumber(stringView());
+            return n.integer ? (double)n.i : n.d;
+        }
         default:
             return defaultValue;
         }
@@ -448,7 +1047,6 @@ namespace Json
 
     long long Value::asLongLong(long long defaultValue) const
     {
-        char *p = 0;
         switch (_type)
         {
         case Type::BOOLEAN:
@@ -458,7 +1056,16 @@ namespace Json
         case Type::NUMBER:
             return (long long)_value._d;
         case Type::STRING:
-            return strtoll(_value._s->c_str(), &p, 10);
+        {
+            Number n = stringToNumber(stringView());
+            if (n.integer)
+                return n.i;
+            if (!(n.d > (double)LLONG_MIN))
+                return LLONG_MIN;
+            if (!(n.d < (double)LLONG_MAX))
+                return LLONG_MAX;
+            return (long long)n.d;
+        }
         default:
             return defaultValue;
         }
@@ -484,18 +1091,25 @@ namespace Json
         case Type::NUMBER:
             return numberToString(_value._d);
         case Type::STRING:
-            return *_value._s;
+            return std::string(stringView());
         case Type::UNDEFINED:
         default:
             return defaultValue;
         }
     }
 
-    const std::string &Value::asConstString(const std::string &defaultValue) const
+    std::string Value::asConstString(const std::string &defaultValue) const
     {
-        if (_type == Type::STRING)
-            return *_value._s;
-        return defaultValue;
+        if (_type != Type::STRING)
+            return defaultValue;
+        return std::string(stringView());
+    }
+
+    std::string_view Value::asStringView(std::string_view defaultValue) const
+    {
+        if (_type != Type::STRING)
+            return defaultValue;
+        return stringView();
     }
 
     std::string Value::asEscapedString(const std::string &defaultValue) const
@@ -510,24 +1124,38 @@ namespace Json
         return _value._o->find(str) != _value._o->end();
     }
 
+    bool Value::hasKey(const Key &key) const
+    {
+        if (_type != Type::OBJECT)
+            return false;
+        return _value._o->find(key) != _value._o->end();
+    }
+
     Value &Value::operator[](size_t key)
     {
         if (_type != Type::ARRAY)
         {
-            reset();
-            _type = Type::ARRAY;
-            _value._a = new ArrayContainer;
+            *this = createArray(resource());
         }
-
-        if (key < _value._a->size())
+        else
         {
-            return (*_value._a)[key];
+            unpack();
+            detach();
         }
-        else
+
+        ArrayContainer &a = *_value._a;
+        if (key < a.size())
+            return a[key];
+
+        // новые элементы запоминают ресурс массива
+        size_t n = a.size();
+        a.resize(key + 1);
+        if (std::pmr::memory_resource *r = boundResource())
         {
-            _value._a->resize(key + 1);
-            return _value._a->back();
+            for (size_t i = n; i <= key; ++i)
+                a[i].bind(r);
         }
+        return a.back();
     }
 
     Value &Value::add(const Value &v)
@@ -537,31 +1165,37 @@ namespace Json
 
     Value &Value::add(Value &&v)
     {
-        return (*this)[size()] = std::move(v);
+        return (*this)[size()].assign(std::move(v));
     }
 
     Value &Value::operator[](const std::string &key)
     {
         if (_type != Type::OBJECT)
-        {
-            reset();
-            _type = Type::OBJECT;
-            _value._o = new ObjectContainer;
-        }
+            *this = createObject(resource());
+        else
+            detach();
 
-        return _value._o->operator[](key);
+        return (*_value._o)[key];
     }
 
     Value &Value::operator[](std::string &&key)
     {
         if (_type != Type::OBJECT)
-        {
-            reset();
-            _type = Type::OBJECT;
-            _value._o = new ObjectContainer;
-        }
+            *this = createObject(resource());
+        else
+            detach();
 
-        return _value._o->operator[](std::move(key));
+        return (*_value._o)[key];
+    }
+
+    Value &Value::operator[](const Key &key)
+    {
+        if (_type != Type::OBJECT)
+            *this = createObject(resource());
+        else
+            detach();
+
+        return (*_value._o)[key];
     }
 
     const Value &Value::operator[](const std::string &key) const
@@ -570,7 +1204,7 @@ namespace Json
         {
         case Type::OBJECT:
         {
-            ObjectContainer::iterator i = _value._o->find(key);
+            ObjectContainer::const_iterator i = _value._o->find(key);
             if (i != _value._o->end())
                 return i->second;
         }
@@ -582,14 +1216,25 @@ namespace Json
         return _emptyValue;
     }
 
+    const Value &Value::operator[](const Key &key) const
+    {
+        if (_type == Type::OBJECT)
+        {
+            ObjectContainer::const_iterator i = _value._o->find(key);
+            if (i != _value._o->end())
+                return i->second;
+        }
+        return _emptyValue;
+    }
+
     const Value &Value::operator[](size_t key) const
     {
         switch (_type)
         {
         case Type::ARRAY:
         {
-            if (key < _value._a->size())
-                return (*_value._a)[key];
+            if (key < size())
+                return isPacked() ? packedElements()[key] : (*_value._a)[key];
         }
         break;
 
@@ -604,6 +1249,10 @@ namespace Json
         switch (_type)
         {
         case Type::ARRAY:
+            if (_kind == PACKED_NUMBER)
+                return _value._na->size();
+            if (_kind == PACKED_INTEGER)
+                return _value._ia->size();
             return _value._a->size();
         case Type::OBJECT:
             return _value._o->size();
@@ -614,10 +1263,17 @@ namespace Json
 
     void Value::reserve(size_t size)
     {
+        detach();
+
         switch (_type)
         {
         case Type::ARRAY:
-            _value._a->reserve(size);
+            if (_kind == PACKED_NUMBER)
+                _value._na->reserve(size);
+            else if (_kind == PACKED_INTEGER)
+                _value._ia->reserve(size);
+            else
+                _value._a->reserve(size);
             break;
         case Type::OBJECT:
             _value._o->reserve(size);
@@ -629,10 +1285,19 @@ namespace Json
 
     void Value::clear()
     {
+        detach();
+        if (isPacked())
+            dropPackedElements();
+
         switch (_type)
         {
         case Type::ARRAY:
-            _value._a->clear();
+            if (_kind == PACKED_NUMBER)
+                _value._na->clear();
+            else if (_kind == PACKED_INTEGER)
+                _value._ia->clear();
+            else
+                _value._a->clear();
             break;
 
         case Type::OBJECT:
@@ -646,12 +1311,22 @@ namespace Json
 
     void Value::erase(const Value &key)
     {
+        detach();
+
         switch (_type)
         {
         case Type::ARRAY:
         {
             int N = key.asInt();
-            if (N >= 0 && (size_t)N < _value._a->size())
+            if (N < 0 || (size_t)N >= size())
+                break;
+            if (isPacked())
+                dropPackedElements();
+            if (_kind == PACKED_NUMBER)
+                _value._na->erase(_value._na->begin() + (ptrdiff_t)N);
+            else if (_kind == PACKED_INTEGER)
+                _value._ia->erase(_value._ia->begin() + (ptrdiff_t)N);
+            else
                 _value._a->erase(_value._a->begin() + (ptrdiff_t)N);
         }
         break;
@@ -702,8 +1377,10 @@ namespace Json
             case Type::NUMBER:
                 return _value._d == v._value._d;
             case Type::STRING:
-                return *_value._s == *v._value._s;
+                return stringView() == v.stringView();
             case Type::ARRAY:
+                if (isPacked() || v.isPacked())
+                    return equalElements(v);
                 return *_value._a == *v._value._a;
             case Type::OBJECT:
                 return *_value._o == *v._value._o;
@@ -720,7 +1397,7 @@ namespace Json
             case Type::NUMBER:
                 return asNumber() == v._value._d;
             case Type::STRING:
-                return asString() == *v._value._s;
+                return asString() == v.stringView();
             case Type::UNDEFINED:
             case Type::ARRAY:
             case Type::OBJECT:
@@ -740,7 +1417,19 @@ namespace Json
         return prettyStringify(*this);
     }
 
-    ObjectContainer *Value::asObject() const
+    ObjectContainer *Value::asObject()
+    {
+        switch (_type)
+        {
+        case Type::OBJECT:
+            detach();
+            return _value._o;
+        default:
+            return nullptr;
+        }
+    }
+
+    const ObjectContainer *Value::asObject() const
     {
         switch (_type)
         {
@@ -751,21 +1440,28 @@ namespace Json
         }
     }
 
-    ArrayContainer *Value::asArray() const
+    ArrayContainer *Value::asArray()
     {
         switch (_type)
         {
         case Type::ARRAY:
+            unpack();
+            detach();
             return _value._a;
         default:
             return nullptr;
         }
     }
 
-    std::ostream &operator<<(std::ostream &os, const Value &value)
+    const ArrayContainer *Value::asArray() const
     {
-        os << value.stringifyThis();
-        return os;
+        switch (_type)
+        {
+        case Type::ARRAY:
+            return isPacked() ? &packedElements() : _value._a;
+        default:
+            return nullptr;
+        }
     }
 
     ////////////////////////////////////////////////////////////////////////////
@@ -780,268 +1476,400 @@ namespace Json
 
 
     ////////////////////////////////////////////////////////////////////////////////
-    Json::Value parseValue(const char *&data, const char *end);
-
-    ////////////////////////////////////////////////////////////////////////////////
-    inline char ISXDIGIT(char c)
-    {
-        switch (c)
-        {
-        case '0':
-        case '1':
-        case '2':
-        case '3':
-        case '4':
-        case '5':
-        case '6':
-        case '7':
-        case '8':
-        case '9':
-        case 'A':
-        case 'B':
-        case 'C':
-        case 'D':
-        case 'E':
-        case 'F':
-        case 'a':
-        case 'b':
-        case 'c':
-        case 'd':
-        case 'e':
-        case 'f':
-            return true;
+    static Json::Value parseNumber(const char *&data, const char *end)
+    {
+        Number n;
+        data = scanNumber(data, end, n);
+        if (n.integer)
+            return n.i;
+        return n.d;
+    }
 
-        default:
-            return false;
+    static Json::Value makeString(const char *data, const char *end, Document *doc, std::pmr::memory_resource *r)
+    {
+        if (doc || r != std::pmr::get_default_resource())
+        {
+            std::string_view s(data, end - data);
+            thread_local std::string unescaped;
+            if (memchr(data, '\\', end - data) != nullptr)
+            {
+                unescaped.clear();
+                unescapestringto(unescaped, data, end - data);
+                s = unescaped;
+            }
+            return doc ? doc->createString(s) : Value::createString(s, r);
         }
+
+        std::string s;
+        unescapestringto(s, data, end - data);
+        return Json::Value(std::move(s));
     }
 
-    inline Json::Value parseNumber(const char *&data, const char *end)
+    ////////////////////////////////////////////////////////////////////////////////
+    //
+    //  Вторая стадия: построение дерева по структурному индексу.
+    //  Разбирает только корректный JSON; на любой неожиданной лексеме
+    //  возвращает false, и parseJson повторяет разбор скалярным путём.
+    //
+    class IndexedParser
     {
-        const char *buf = data;
-        bool isDot = false;
-        while (data < end)
+    public:
+        IndexedParser(const char *data, const char *end, const uint32_t *first, const uint32_t *last, Document *doc,
+                      std::pmr::memory_resource *r, bool reuse = false)
+            : _data(data), _end(end), _cur(first), _last(last), _doc(doc), _resource(r), _reuse(reuse)
         {
-            switch (*data)
-            {
-            case '-':
-            case '+':
-            case '0':
-            case '1':
-            case '2':
-            case '3':
-            case '4':
-            case '5':
-            case '6':
-            case '7':
-            case '8':
-            case '9':
-                break;
+        }
+
+        bool value(Value &out)
+        {
+            if (_cur == _last)
+                return false;
 
-            case '.':
-            case 'E':
-            case 'e':
-                isDot = true;
-                break;                
+            switch (_data[*_cur])
+            {
+            case '{':
+                ++_cur;
+                return object(out);
+            case '[':
+                ++_cur;
+                return array(out);
+            case '\"':
+            {
+                const char *b, *e;
+                if (!string(b, e))
+                    return false;
 
+                if (!_reuse || !overwrite(out, b, e))
+                    out = makeString(b, e, _doc, _resource);
+                return true;
+            }
             default:
-                goto PARSE_NUMBER_END;
+                return atom(out);
             }
-            ++data;
         }
-    PARSE_NUMBER_END:
-        size_t size = data - buf;
-        if (isDot || size > 20) {
-            return strtod(buf, nullptr);
-        }
-        else {
-            return strtoll(buf, nullptr, 10);
-        }
-    }
 
-    inline Json::Value parseString(const char *&data, const char *end)
-    {
-        const char *buf = data;
-        while (data < end)
+        /* все лексемы отрезка разобраны */
+        bool done() const { return _cur == _last; }
+
+    private:
+        // строка в куче или в ресурсе перезаписывается на месте, если помещается
+        bool overwrite(Value &out, const char *b, const char *e)
         {
-            if ((unsigned char)(*data) < ' ')
+            if (out._type != Value::Type::STRING)
+                return false;
+            if (out._kind == Value::OWNED)
             {
-                goto PARSE_STRING_END;
+                out._value._s->clear();
+                unescapestringto(*out._value._s, b, e - b);
+                return true;
             }
+            if (out._kind != Value::ALLOCATED)
+                return false;
 
-            switch (*data)
+            size_t capacity = allocatedHeader(out._value._v)->capacity;
+            char *p = const_cast<char *>(out._value._v);
+            size_t n;
+            if ((size_t)(e - b) <= capacity)
             {
-            case '\\':
+                n = unescapestringto(p, b, e - b);
+            }
+            else
             {
-                ++data;
+                // с escape-последовательностями строка короче записи
+                if (memchr(b, '\\', e - b) == nullptr)
+                    return false;
+                _unescaped.clear();
+                unescapestringto(_unescaped, b, e - b);
+                n = _unescaped.size();
+                if (n > capacity)
+                    return false;
+                memcpy(p, _unescaped.data(), n);
+            }
+            p[n] = 0;
+            out._size = (uint32_t)n;
+            return true;
+        }
 
-                if (data < end)
-                {
-                    switch (*data)
-                    {
-                    case '\"':
-                    case '\\':
-                    case '/':
-                    case 'b':
-                    case 'f':
-                    case 'n':
-                    case 'r':
-                    case 't':
-                        ++data;
-                        break;
+        // при повторном использовании собственный контейнер out остаётся
+        static bool reusable(const Value &out, Value::Type type)
+        {
+            return out._type == type && out._kind != Value::SHARED;
+        }
 
-                    case 'u':
-                        if (
-                            end - data > 4 && ISXDIGIT((int)*(data + 1)) && ISXDIGIT((int)*(data + 2)) && ISXDIGIT((int)*(data + 3)) && ISXDIGIT((int)*(data + 4)))
-                        {
-                            data += 5;
-                        }
-                        else
-                        {
-                            goto PARSE_STRING_END;
-                        }
-                        break;
+        bool object(Value &out)
+        {
+            // члены прежнего объекта, ключи которых идут в том же порядке,
+            // разбираются на месте; с первого несовпадения остаток удаляется
+            bool reuse = _reuse && reusable(out, Value::Type::OBJECT);
+            if (!reuse)
+                out = _doc ? _doc->createObject() : Value::createObject(_resource);
+            ObjectContainer *ocp = out._value._o;
+            size_t next = 0;
+
+            if (_cur != _last && _data[*_cur] == '}')
+            {
+                ++_cur;
+                if (reuse)
+                    ocp->clear();
+                return true;
+            }
 
-                    default:
-                        goto PARSE_STRING_END;
-                    }
+            while (_cur != _last)
+            {
+                const char *b, *e;
+                if (_data[*_cur] != '\"' || !string(b, e))
+                    return false;
+                std::string_view key(b, e - b);
+                if (memchr(b, '\\', e - b))
+                {
+                    _key.clear();
+                    unescapestringto(_key, b, e - b);
+                    key = _key;
+                }
+                if (_cur == _last || _data[*_cur] != ':')
+                    return false;
+                ++_cur;
+
+                // значение разбирается сразу на место; при повторном ключе остаётся первое
+                Value *slot;
+                Value discarded;
+                if (reuse && next < ocp->size() && ocp->begin()[next].first == key)
+                {
+                    slot = &ocp->begin()[next++].second;
                 }
                 else
                 {
-                    goto PARSE_STRING_END;
+                    if (reuse)
+                    {
+                        ocp->erase(ocp->begin() + next, ocp->end());
+                        reuse = false;
+                    }
+                    auto r = ocp->try_emplace(key);
+                    slot = r.second ? &r.first->second : &discarded;
+                }
+                if (!value(*slot))
+                    return false;
+
+                if (_cur == _last)
+                    return false;
+                switch (_data[*_cur++])
+                {
+                case ',':
+                    break;
+                case '}':
+                    if (reuse)
+                        ocp->erase(ocp->begin() + next, ocp->end());
+                    return true;
+                default:
+                    return false;
                 }
             }
-            break;
-
-            case '\"':
-                goto PARSE_STRING_END;
+            return false;
+        }
 
-            default:
-                ++data;
+        bool array(Value &out)
+        {
+            // элементы прежнего массива перезаписываются по порядку, лишние удаляются
+            bool reuse = _reuse && reusable(out, Value::Type::ARRAY);
+            if (!reuse)
+                out = _doc ? _doc->createArray() : Value::createArray(_resource);
+            else if (out.isPacked())
+                return packedArray(out);
+
+            if (_cur != _last && _data[*_cur] == ']')
+            {
+                ++_cur;
+                out._value._a->clear();
+                return true;
             }
+            return elements(out, 0);
         }
 
-    PARSE_STRING_END:
-        std::string s;
-        unescapestringto(s, buf, data - buf);
-        if (*data == '\"')
-            ++data;
+        // элементы массива с n-го до закрывающей скобки
+        bool elements(Value &out, size_t n)
+        {
+            ArrayContainer *acp = out._value._a;
+            while (_cur != _last)
+            {
+                if (n == acp->size())
+                    acp->emplace_back(_resource);
+                if (!value((*acp)[n++]))
+                    return false;
+
+                if (_cur == _last)
+                    return false;
+                switch (_data[*_cur++])
+                {
+                case ',':
+                    break;
+                case ']':
+                    closeArray(out, n);
+                    return true;
+                default:
+                    return false;
+                }
+            }
+            return false;
+        }
 
-        return std::move(s);
-    }
+        void closeArray(Value &out, size_t n)
+        {
+            ArrayContainer *acp = out._value._a;
+            if (n < acp->size())
+                acp->erase(acp->begin() + n, acp->end());
+            if (n >= Value::packThreshold && packArrays())
+                out.pack();
+        }
 
-    inline Json::Value parseObject(const char *&data, const char *end)
-    {
-        Json::Value obj = Json::Value::createObject();
-        Json::ObjectContainer *ocp = obj.asObject();
-        Json::Value key;
-        while (data < end)
+        // упакованный массив заполняется числами того же типа; на другом
+        // значении он распаковывается и разбор продолжается как обычно
+        bool packedArray(Value &out)
         {
-            switch (*data)
+            NumberContainer *na = out._kind == Value::PACKED_NUMBER ? out._value._na : nullptr;
+            IntegerContainer *ia = out._kind == Value::PACKED_INTEGER ? out._value._ia : nullptr;
+            size_t n = 0;
+
+            if (_cur != _last && _data[*_cur] == ']')
             {
-            case ':':
-            case ',':
-            case ' ':
-            case '\n':
-            case '\r':
-            case '\t':
-                ++data;
-                break;
+                ++_cur;
+                na ? na->clear() : ia->clear();
+                return true;
+            }
 
-            case '}':
-            case ']':
-                ++data;
-                goto PARSE_OBJECT_END;
+            while (_cur != _last)
+            {
+                Value e;
+                if (!value(e))
+                    return false;
 
-            case '\"':
-                if (key.type() == Json::Value::Type::UNDEFINED) {
-                    key = parseString(++data, end);
-                    break;
+                if (na && e._type == Value::Type::NUMBER)
+                {
+                    if (n == na->size())
+                        na->push_back(e._value._d);
+                    else
+                        (*na)[n] = e._value._d;
                 }
+                else if (ia && e._type == Value::Type::INTEGER)
+                {
+                    if (n == ia->size())
+                        ia->push_back(e._value._i);
+                    else
+                        (*ia)[n] = e._value._i;
+                }
+                else
+                {
+                    na ? na->resize(n) : ia->resize(n);
+                    out.unpack();
+                    out._value._a->emplace_back(_resource) = std::move(e);
 
-            default:
-                if (key.type() == Json::Value::Type::STRING) {
-                    ocp->emplace(
-                        key.asString(),
-                        parseValue(data, end)
-                    );
-                    key.reset();
+                    if (_cur == _last)
+                        return false;
+                    switch (_data[*_cur++])
+                    {
+                    case ',':
+                        return elements(out, n + 1);
+                    case ']':
+                        closeArray(out, n + 1);
+                        return true;
+                    default:
+                        return false;
+                    }
                 }
-                else {
-                    ++data;
+                ++n;
+
+                if (_cur == _last)
+                    return false;
+                switch (_data[*_cur++])
+                {
+                case ',':
+                    break;
+                case ']':
+                    na ? na->resize(n) : ia->resize(n);
+                    return true;
+                default:
+                    return false;
                 }
-                break;
             }
+            return false;
         }
-    PARSE_OBJECT_END:
-        return obj;
-    }
 
-    inline Json::Value parseArray(const char *&data, const char *end)
-    {
-        Json::Value array = Json::Value::createArray();
-        Json::ArrayContainer *acp = array.asArray();
-        while (data < end)
+        // открывающая кавычка в индексе всегда сопровождается закрывающей
+        bool string(const char *&b, const char *&e)
         {
-            switch (*data)
+            if (_last - _cur < 2)
+                return false;
+
+            b = _data + _cur[0] + 1;
+            e = _data + _cur[1];
+            _cur += 2;
+
+            const char *bs = (const char *)memchr(b, '\\', e - b);
+            if (bs == nullptr)
+                return true;
+
+            for (const char *p = bs; p < e; ++p)
             {
-            case ',':
-            case ' ':
-            case '\n':
-            case '\r':
-            case '\t':
-                ++data;
-                break;
+                if (*p != '\\')
+                    continue;
+                switch (*++p)
+                {
+                case '\"':
+                case '\\':
+                case '/':
+                case 'b':
+                case 'f':
+                case 'n':
+                case 'r':
+                case 't':
+                    break;
 
-            case ']':
-            case '}':
-                ++data;
-                goto PARSE_ARRAY_END;
+                case 'u':
+                    if (e - p > 4 && ISXDIGIT(p[1]) && ISXDIGIT(p[2]) && ISXDIGIT(p[3]) && ISXDIGIT(p[4]))
+                    {
+                        p += 4;
+                        break;
+                    }
+                    return false;
 
-            default:
-                acp->emplace_back(parseValue(data, end));
+                default:
+                    return false;
+                }
             }
+            return true;
         }
-    PARSE_ARRAY_END:
-        return array;
-    }
 
-    inline Json::Value parseValue(const char *&data, const char *end)
-    {
-        while (data < end)
+        bool atom(Value &out)
         {
-            switch (*data)
-            {
-            case '{':
-                return parseObject(++data, end);
-            case '[':
-                return parseArray(++data, end);
-            case '\"':
-                return parseString(++data, end);
+            const char *b = _data + *_cur;
+            const char *e = ++_cur == _last ? _end : _data + *_cur;
+            while (e > b && (e[-1] == ' ' || e[-1] == '\n' || e[-1] == '\r' || e[-1] == '\t'))
+                --e;
 
+            switch (*b)
+            {
             case 'n':
-                if ((end - data >= 4) && strncmp(data, "null", 4) == 0) {
-                    data += 4;
-                    return {};
+                if (e - b == 4 && memcmp(b, "null", 4) == 0)
+                {
+                    out.reset();
+                    return true;
                 }
-                ++data;
-                break;
+                return false;
 
             case 't':
-                if ((end - data >= 4) && strncmp(data, "true", 4) == 0) {
-                    data += 4;
-                    return {true};
+                if (e - b == 4 && memcmp(b, "true", 4) == 0)
+                {
+                    out = true;
+                    return true;
                 }
-                ++data;
-                break;
+                return false;
 
             case 'f':
-                if ((end - data >= 5) && strncmp(data, "false", 5) == 0) {
-                    data += 5;
-                    return {false};
+                if (e - b == 5 && memcmp(b, "false", 5) == 0)
+                {
+                    out = false;
+                    return true;
                 }
-                ++data;
-                break;
+                return false;
 
             case '-':
             case '0':
@@ -1054,19 +1882,88 @@ namespace Json
             case '7':
             case '8':
             case '9':
-                return parseNumber(data, end);
+                out = parseNumber(b, e);
+                return b == e;
 
             default:
-                ++data;
-                break;
+                return false;
             }
         }
-        return Json::Value();
+
+        const char *_data;
+        const char *_end;
+        const uint32_t *_cur;
+        const uint32_t *_last;
+        Document *_doc;
+        std::pmr::memory_resource *_resource; // без документа узлы и строки размещаются здесь
+        bool _reuse;                          // разбор поверх прежнего значения, см. parseInto
+        std::string _key;       // раскрытый ключ с escape-последовательностями
+        std::string _unescaped; // раскрытая строка, см. overwrite
+    };
+
+    bool parseIndexed(const char *data, const char *end, const uint32_t *first, const uint32_t *last,
+                      Document *doc, Value &out)
+    {
+        IndexedParser parser(data, end, first, last, doc, std::pmr::get_default_resource());
+        return parser.value(out) && parser.done();
+    }
+
+    // разбор в out: узлы и строки размещаются в арене документа doc или, без
+    // документа, в ресурсе r; reuse — память прежнего значения out используется повторно
+    static void parseJson(const char *data, const char *end, Document *doc, std::pmr::memory_resource *r, bool reuse,
+                          Value &out)
+    {
+        thread_local StructuralIndex index;
+
+        if (buildStructuralIndex(data, end, index))
+        {
+            IndexedParser parser(data, end, index.data(), index.data() + index.size(), doc, r, reuse);
+            bool ok = parser.value(out);
+
+            // не держим память под индекс после разбора больших документов
+            if (index.capacity() > (1 << 20))
+                StructuralIndex().swap(index);
+
+            if (ok)
+                return;
+        }
+
+        // некорректный JSON или нет SIMD: снисходительный разбор по событиям
+        ValueBuilder builder(doc, r);
+        SaxReader<ValueBuilder> reader(builder);
+        reader.parse(data, end);
+        out = builder.release();
+    }
+
+    Json::Value parseJson(const char *data, const char *end, Document *doc)
+    {
+        Value res;
+        parseJson(data, end, doc, std::pmr::get_default_resource(), false, res);
+        return res;
+    }
+
+    Json::Value parseJson(const char *data, const char *end, std::pmr::memory_resource *r)
+    {
+        Value res;
+        parseJson(data, end, nullptr, r, false, res);
+        return res;
     }
 
     Json::Value parseJson(const char *data, const char *end)
     {
-        return parseValue(data, end);
+        Value res;
+        parseJson(data, end, nullptr, std::pmr::get_default_resource(), false, res);
+        return res;
+    }
+
+    void parseInto(Value &target, const char *data, const char *end)
+    {
+        parseJson(data, end, nullptr, target.resource(), true, target);
+    }
+
+    void parseInto(Value &target, const char *data)
+    {
+        parseInto(target, data, data + strlen(data));
     }
 
     Json::Value parseJson(const char *data)
@@ -1076,28 +1973,17 @@ namespace Json
 
     Value parse_file(const char *fileName)
     {
-        Value res;
-        char *js = 0;
-        size_t filesize = 0;
+        std::string error;
+        return parse_file(fileName, error);
+    }
 
-        FILE *f = fopen(fileName, "r");
-        if (f == 0)
-        {
-            return res;
-        }
+    Value parse_file(const char *fileName, std::string &error)
+    {
+        MappedFile file;
+        if (!file.open(fileName, error))
+            return Value();
 
-        fseek(f, 0, SEEK_END);
-        filesize = (size_t)ftell(f);
-        fseek(f, 0, SEEK_SET);
-        js = (char *)malloc(filesize);
-        if (js)
-        {
-            filesize = fread(js, 1, filesize, f);
-            fclose(f);
-            res = parseJson(js, js + filesize);
-            free(js);
-        }
-        return res;
+        return parseJson(file.data(), file.end());
     }
 
     ////////////////////////////////////////////////////////////////////////////
@@ -1115,14 +2001,20 @@ namespace Json
             break;
 
         case Value::Type::INTEGER:
+            numberto(res, v.asLongLong());
+            break;
+
         case Value::Type::NUMBER:
+            numberto(res, v.asNumber());
+            break;
+
         case Value::Type::BOOLEAN:
-            res.append(v.asString());
+            res.append(v.asBoolean() ? "true" : "false");
             break;
 
         case Value::Type::STRING:
             res.push_back('\"');
-            escapestringto(res, v.asString());
+            escapestringto(res, v.asStringView());
             res.push_back('\"');
             break;
 
@@ -1131,11 +2023,10 @@ namespace Json
             res.push_back('[');
             res.push_back('\n');
 
-            int i = 0;
-            const ArrayContainer &ac = *v.asArray();
-            for (auto a = ac.begin(), e = ac.end(); a != e; ++a)
+            const double *pn = v.packedNumbers();
+            const int64_t *pi = v.packedIntegers();
+            for (size_t i = 0, n = v.size(); i < n; ++i)
             {
-                const Value &val = *a;
                 if (i)
                 {
                     res.push_back(',');
@@ -1143,9 +2034,12 @@ namespace Json
                 }
 
                 res.append((level + 1) * 4, ' ');
-                prettyStringifyTo(res, val, level + 1, sorted);
-
-                ++i;
+                if (pn)
+                    numberto(res, pn[i]);
+                else if (pi)
+                    numberto(res, (long long)pi[i]);
+                else
+                    prettyStringifyTo(res, v[i], level + 1, sorted);
             }
             res.push_back('\n');
             res.append(level * 4, ' ');
@@ -1160,12 +2054,19 @@ namespace Json
 
             if (sorted)
             {
+                // сортируются указатели на члены, ключи не копируются
+                std::vector<const ObjectContainer::value_type *> members;
+                members.reserve(v.size());
+                for (const auto &p : *v.asObject())
+                    members.push_back(&p);
+                std::sort(members.begin(), members.end(),
+                          [](const ObjectContainer::value_type *a, const ObjectContainer::value_type *b) {
+                              return a->first.view() < b->first.view();
+                          });
+
                 int i = 0;
-                std::vector<std::string> keys = v.indexes();
-                std::sort(keys.begin(), keys.end());
-                for (const auto &key : keys)
+                for (const auto *p : members)
                 {
-                    const Value &val = v[key];
                     if (i)
                     {
                         res.push_back(',');
@@ -1174,10 +2075,10 @@ namespace Json
 
                     res.append((level + 1) * 4, ' ');
                     res.push_back('\"');
-                    escapestringto(res, key);
+                    escapestringto(res, p->first);
                     res.push_back('\"');
                     res.push_back(':');
-                    prettyStringifyTo(res, val, level + 1, sorted);
+                    prettyStringifyTo(res, p->second, level + 1, sorted);
 
                     ++i;
                 }
@@ -1223,51 +2124,312 @@ namespace Json
         return prettyStringifyTo(res, v, 0, sorted);
     }
 
+    ////////////////////////////////////////////////////////////////////////////
+    //
+    //  Компактная запись. Первый проход считает оценку размера сверху: точную
+    //  для всего, кроме double, которым отводится maxNumberSize (кратчайшая
+    //  запись обычно короче, но узнать её длину можно только записав число).
+    //  Память выделяется один раз, второй проход пишет по указателю без
+    //  проверок границ, лишнее отрезается.
+    //
+    typedef std::vector<const ObjectContainer::value_type *> MemberList;
+
+    static size_t integerSize(long long v)
+    {
+        unsigned long long u = v < 0 ? 0 - (unsigned long long)v : (unsigned long long)v;
+        size_t n = v < 0 ? 2 : 1;
+        for (unsigned long long p = 10; u >= p && p < 10000000000000000000ULL; p *= 10)
+            ++n;
+        return n;
+    }
+
+    static size_t compactSizeBound(const Value &v)
+    {
+        switch (v.type())
+        {
+        case Value::Type::UNDEFINED:
+            return 4;
+        case Value::Type::BOOLEAN:
+            return v.asBoolean() ? 4 : 5;
+        case Value::Type::INTEGER:
+            return integerSize(v.asLongLong());
+        case Value::Type::NUMBER:
+            return maxNumberSize;
+        case Value::Type::STRING:
+            return escapedSize(v.asStringView()) + 2;
+
+        case Value::Type::ARRAY:
+        {
+            size_t n = v.size();
+            size_t size = n ? n + 1 : 2; // скобки и запятые
+            if (v.packedNumbers())
+            {
+                size += n * maxNumberSize;
+            }
+            else if (const int64_t *pi = v.packedIntegers())
+            {
+                for (size_t i = 0; i < n; ++i)
+                    size += integerSize((long long)pi[i]);
+            }
+            else
+            {
+                for (const Value &e : *v.asArray())
+                    size += compactSizeBound(e);
+            }
+            return size;
+        }
+
+        case Value::Type::OBJECT:
+        {
+            const ObjectContainer &o = *v.asObject();
+            size_t size = o.empty() ? 2 : o.size() + 1;
+            for (const auto &p : o)
+                size += escapedSize(p.first) + 3 + compactSizeBound(p.second);
+            return size;
+        }
+
+        default:
+            return 0;
+        }
+    }
+
+    static char *copyTo(char *out, const char *s, size_t n)
+    {
+        memcpy(out, s, n);
+        return out + n;
+    }
+
+    // members — стек указателей на члены для записи с сортировкой ключей, иначе nullptr
+    static char *compactTo(char *out, const Value &v, MemberList *members)
+    {
+        switch (v.type())
+        {
+        case Value::Type::UNDEFINED:
+            return copyTo(out, "null", 4);
+        case Value::Type::BOOLEAN:
+            return v.asBoolean() ? copyTo(out, "true", 4) : copyTo(out, "false", 5);
+        case Value::Type::INTEGER:
+            return writeNumber(out, v.asLongLong());
+        case Value::Type::NUMBER:
+            return writeNumber(out, v.asNumber());
+
+        case Value::Type::STRING:
+            *out++ = '\"';
+            out = escapeTo(out, v.asStringView());
+            *out++ = '\"';
+            return out;
+
+        case Value::Type::ARRAY:
+        {
+            *out++ = '[';
+            size_t n = v.size();
+            if (const double *pn = v.packedNumbers())
+            {
+                for (size_t i = 0; i < n; ++i)
+                {
+                    if (i)
+                        *out++ = ',';
+                    out = writeNumber(out, pn[i]);
+                }
+            }
+            else if (const int64_t *pi = v.packedIntegers())
+            {
+                for (size_t i = 0; i < n; ++i)
+                {
+                    if (i)
+                        *out++ = ',';
+                    out = writeNumber(out, (long long)pi[i]);
+                }
+            }
+            else
+            {
+                const ArrayContainer &a = *v.asArray();
+                for (size_t i = 0; i < n; ++i)
+                {
+                    if (i)
+                        *out++ = ',';
+                    out = compactTo(out, a[i], members);
+                }
+            }
+            *out++ = ']';
+            return out;
+        }
+
+        case Value::Type::OBJECT:
+        {
+            const ObjectContainer &o = *v.asObject();
+            *out++ = '{';
+            if (members)
+            {
+                // стек растёт при вложенных объектах, поэтому обход по номерам
+                size_t base = members->size();
+                for (const auto &p : o)
+                    members->push_back(&p);
+                std::sort(members->begin() + base, members->end(),
+                          [](const ObjectContainer::value_type *a, const ObjectContainer::value_type *b) {
+                              return a->first.view() < b->first.view();
+                          });
+
+                for (size_t i = base, n = members->size(); i < n; ++i)
+                {
+                    const ObjectContainer::value_type *p = (*members)[i];
+                    if (i != base)
+                        *out++ = ',';
+                    *out++ = '\"';
+                    out = escapeTo(out, p->first);
+                    *out++ = '\"';
+                    *out++ = ':';
+                    out = compactTo(out, p->second, members);
+                }
+                members->resize(base);
+            }
+            else
+            {
+                int i = 0;
+                for (const auto &p : o)
+                {
+                    if (i++)
+                        *out++ = ',';
+                    *out++ = '\"';
+                    out = escapeTo(out, p.first);
+                    *out++ = '\"';
+                    *out++ = ':';
+                    out = compactTo(out, p.second, nullptr);
+                }
+            }
+            *out++ = '}';
+            return out;
+        }
+
+        default:
+            return out;
+        }
+    }
+
+    static std::string &compactStringifyTo(std::string &buff, const Value &v, MemberList *members)
+    {
+        size_t n = buff.size();
+        size_t bound = compactSizeBound(v);
+#ifdef __cpp_lib_string_resize_and_overwrite
+        // место под оценку не заполняется нулями
+        buff.resize_and_overwrite(n + bound, [&](char *p, size_t) { return compactTo(p + n, v, members) - p; });
+#else
+        buff.resize(n + bound);
+        buff.resize(compactTo(&buff[n], v, members) - buff.data());
+#endif
+        return buff;
+    }
+
+    std::string &stringifyto(std::string &buff, const Value &v)
+    {
+        return compactStringifyTo(buff, v, nullptr);
+    }
+
     std::string stringify(const Value &v, bool sorted)
     {
-        return prettyStringify(v, sorted);
+        std::string res;
+        if (!sorted)
+        {
+            compactStringifyTo(res, v, nullptr);
+            return res;
+        }
+
+        thread_local MemberList members;
+        members.clear();
+        compactStringifyTo(res, v, &members);
+        return res;
+    }
+
+    // запись та же, что у stringifyThis, но без промежуточной строки: короткий
+    // скаляр собирается на стеке, остальное идёт через StreamWriter с
+    // наименьшим буфером
+    std::ostream &operator<<(std::ostream &os, const Value &value)
+    {
+        if (!value.isArray() && !value.isObject())
+        {
+            char buff[256];
+            if (compactSizeBound(value) <= sizeof(buff))
+            {
+                os.write(buff, compactTo(buff, value, nullptr) - buff);
+                return os;
+            }
+        }
+
+        StreamWriter(os, StreamWriter::minBufferSize).write(value, false, true);
+        return os;
     }
 
     ////////////////////////////////////////////////////////////////////////////
     //
+    //  Каноническая запись, RFC 8785. Строки экранируются так же, как в
+    //  компактной записи (escape.h)
     //
-    //
-    //
-    std::string &stringifyto(std::string &buff, const Value &v)
+    static void canonicalNumberTo(std::string &buff, double v)
     {
-        switch (v._type)
+        size_t n = buff.size();
+        buff.resize(n + 32);
+        buff.resize(writeCanonicalNumber(&buff[n], v) - buff.data());
+    }
+
+    /* Ключи упорядочиваются по кодовым единицам UTF-16. В UTF-8 этот порядок
+       совпадает с побайтовым, кроме символов вне BMP (первый байт 0xF0..0xF4):
+       их суррогатные пары идут раньше символов U+E000..U+FFFF (0xEE, 0xEF) */
+    static bool canonicalKeyLess(std::string_view a, std::string_view b)
+    {
+        size_t n = std::min(a.size(), b.size());
+        size_t i = 0;
+        while (i < n && a[i] == b[i])
+            ++i;
+        if (i == n)
+            return a.size() < b.size();
+
+        unsigned char ca = (unsigned char)a[i];
+        unsigned char cb = (unsigned char)b[i];
+        if (ca >= 0xEE && cb >= 0xEE && (ca >= 0xF0) != (cb >= 0xF0))
+            return ca >= 0xF0;
+        return ca < cb;
+    }
+
+    // members — общий стек указателей на члены объектов по всей глубине
+    static void canonicalStringifyTo(std::string &buff, const Value &v, MemberList &members)
+    {
+        switch (v.type())
         {
         case Value::Type::UNDEFINED:
             buff.append("null");
             break;
 
-        case Value::Type::INTEGER:
-            buff.append(numberToString(v._value._i));
+        case Value::Type::BOOLEAN:
+            buff.append(v.asBoolean() ? "true" : "false");
             break;
 
+        // целые записываются как double, как их прочтёт ECMAScript
+        case Value::Type::INTEGER:
         case Value::Type::NUMBER:
-            buff.append(numberToString(v._value._d));
-            break;
-
-        case Value::Type::BOOLEAN:
-            buff.append(v._value._l ? "true" : "false");
+            canonicalNumberTo(buff, v.asNumber());
             break;
 
         case Value::Type::STRING:
             buff.push_back('\"');
-            escapestringto(buff, *v._value._s);
+            escapestringto(buff, v.asStringView());
             buff.push_back('\"');
             break;
 
         case Value::Type::ARRAY:
         {
             buff.push_back('[');
-            int i = 0;
-            for (auto &av : *v.asArray())
+            const double *pn = v.packedNumbers();
+            const int64_t *pi = v.packedIntegers();
+            for (size_t i = 0, n = v.size(); i < n; ++i)
             {
-                if (i++)
+                if (i)
                     buff.push_back(',');
-                stringifyto(buff, av);
+                if (pn)
+                    canonicalNumberTo(buff, pn[i]);
+                else if (pi)
+                    canonicalNumberTo(buff, (double)pi[i]);
+                else
+                    canonicalStringifyTo(buff, (*v.asArray())[i], members);
             }
             buff.push_back(']');
         }
@@ -1275,27 +2437,49 @@ namespace Json
 
         case Value::Type::OBJECT:
         {
+            // стек растёт при вложенных объектах, поэтому обход по номерам
+            size_t base = members.size();
+            for (const auto &p : *v.asObject())
+                members.push_back(&p);
+            std::sort(members.begin() + base, members.end(),
+                      [](const ObjectContainer::value_type *a, const ObjectContainer::value_type *b) {
+                          return canonicalKeyLess(a->first.view(), b->first.view());
+                      });
+
             buff.push_back('{');
-            int i = 0;
-            for (auto &p : *v.asObject())
+            for (size_t i = base, n = members.size(); i < n; ++i)
             {
-                if (i++)
+                const ObjectContainer::value_type *p = members[i];
+                if (i != base)
                     buff.push_back(',');
                 buff.push_back('\"');
-                escapestringto(buff, p.first);
+                escapestringto(buff, p->first);
                 buff.push_back('\"');
                 buff.push_back(':');
-
-                stringifyto(buff, p.second);
+                canonicalStringifyTo(buff, p->second, members);
             }
             buff.push_back('}');
+            members.resize(base);
         }
         break;
 
         default:
             break;
         }
+    }
+
+    std::string &canonicalStringifyto(std::string &buff, const Value &v)
+    {
+        thread_local MemberList members;
+        members.clear();
+        canonicalStringifyTo(buff, v, members);
         return buff;
     }
 
+    std::string canonicalStringify(const Value &v)
+    {
+        std::string res;
+        return canonicalStringifyto(res, v);
+    }
+
 } // namespace Json
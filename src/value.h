@@ -1,20 +1,79 @@
 #ifndef VALUE_H
 #define VALUE_H
 
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory_resource>
+#include <new>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
 #include <vector>
 #include <unordered_map>
 
+#if __has_include(<span>)
+#include <span>
+#endif
+
+#include "key.h"
+
 namespace Json
 {
     class Value;
+    class Document;
+    class KeyPool;
+    class ObjectContainer;
+
+    typedef std::pmr::vector<Value> ArrayContainer;
+
+    /* Упаковка массивов при разборе и в конструкторе из std::vector (см.
+       Value::pack). По умолчанию выключена: чтение элемента через
+       неконстантное значение распаковывает массив обратно, а константное
+       строит копию элементов, так что упаковка окупается, только когда
+       числа читаются через packedNumbers и packedIntegers */
+    void setPackArrays(bool enable);
+    bool packArrays();
+
+    /* упакованные массивы чисел одного типа, см. Value::pack */
+    template <class T>
+    class PackedContainer : public std::pmr::vector<T>
+    {
+    public:
+        explicit PackedContainer(std::pmr::memory_resource *r)
+            : std::pmr::vector<T>(r)
+        {
+        }
+
+        PackedContainer(size_t size, std::pmr::memory_resource *r)
+            : std::pmr::vector<T>(size, r)
+        {
+        }
+
+        PackedContainer(const PackedContainer &c, std::pmr::memory_resource *r)
+            : std::pmr::vector<T>(c, r)
+        {
+        }
+
+    private:
+        friend class Value;
+
+        // элементы в виде Value для константного доступа (operator[], asArray):
+        // строятся при первом обращении и публикуются атомарно, сами числа
+        // при этом не меняются; владеет ими Value
+        mutable std::atomic<ArrayContainer *> _elements{nullptr};
+    };
+
+    typedef PackedContainer<double> NumberContainer;
+    typedef PackedContainer<int64_t> IntegerContainer;
 
-    typedef std::vector<Value> ArrayContainer;
-    typedef std::unordered_map<std::string, Value> ObjectContainer;
     class Value
     {
     public:
-        enum class Type
+        enum class Type : unsigned char
         {
             UNDEFINED,
             BOOLEAN,
@@ -31,8 +90,46 @@ namespace Json
         Value(const Value &v);
         Value(Value &&v) noexcept;
         Value &operator=(const Value &v);
+
+        /* забирает содержимое v как есть, без выделения памяти */
         Value &operator=(Value &&v) noexcept;
 
+        /* перенос с размещением в ресурсе этого значения: строки и
+           контейнеры v из другого ресурса копируются в него */
+        Value &assign(Value &&v);
+
+        /* строка сразу размещается в ресурсе этого значения */
+        template <class T, class = std::enable_if_t<std::is_convertible_v<T, std::string_view> &&
+                                                    std::is_constructible_v<Value, T>>>
+        Value &operator=(T &&s)
+        {
+            std::pmr::memory_resource *r = boundResource();
+            Value v = r ? createString(s, r) : Value(std::forward<T>(s));
+            steal(v, r);
+            return *this;
+        }
+
+        /* Значения в ресурсе памяти. Контейнеры, длинные ключи и строки
+           значения, созданного в ресурсе r, размещаются в r; элементы,
+           которые появляются через add, operator[], копирующее присваивание,
+           присваивание строки и assign, тоже попадают в r: строки и
+           контейнеры из другого ресурса копируются, строки в ресурсе не
+           хранятся внутри значения.
+           Перенос (operator=(Value &&)) содержимое не копирует, перенесённое
+           остаётся в своём ресурсе. Ресурс не запоминают элементы,
+           добавленные напрямую через asArray и asObject, и строки документа,
+           которые остаются в его памяти.
+           Ресурс должен жить дольше значений в нём; с монотонным ресурсом
+           удобно размещать всё дерево одного запроса и освобождать разом:
+               std::pmr::monotonic_buffer_resource arena;
+               Json::Value v = Json::parseJson(data, end, &arena);
+           Адрес ресурса (кроме ресурса по умолчанию) должен помещаться в 48
+           бит, иначе конструктор и разборщики бросают std::invalid_argument */
+        explicit Value(std::pmr::memory_resource *r);
+
+        /* глубокая копия в ресурсе r */
+        Value(const Value &v, std::pmr::memory_resource *r);
+
         Value(bool v);
         Value(int v);
         Value(size_t v);
@@ -43,28 +140,55 @@ namespace Json
         Value(const std::string &v);
         Value(std::string &&v);
 
+        /* вектор из packThreshold и более чисел хранится упакованным, если
+           включена setPackArrays */
         template <class T>
         Value(const std::vector<T> &v)
-            : _type(Type::ARRAY)
+            : _type(Type::UNDEFINED)
         {
-            _value._a = new ArrayContainer(v.begin(), v.end());
+            if constexpr (std::is_floating_point_v<T>)
+            {
+                // NaN и бесконечность становятся пустыми значениями, такой массив не упаковывается
+                bool finite = true;
+                for (T d : v)
+                    finite = finite && std::isfinite(d);
+                if (v.size() >= packThreshold && finite && packArrays())
+                {
+                    double *p = createPacked<NumberContainer>(v.size(), PACKED_NUMBER);
+                    for (T d : v)
+                        *p++ = (double)d;
+                    return;
+                }
+            }
+            else if constexpr (std::is_integral_v<T> && !std::is_same_v<T, bool>)
+            {
+                if (v.size() >= packThreshold && packArrays())
+                {
+                    int64_t *p = createPacked<IntegerContainer>(v.size(), PACKED_INTEGER);
+                    for (T i : v)
+                        *p++ = (int64_t)i;
+                    return;
+                }
+            }
+
+            *this = createArray();
+            _value._a->assign(v.begin(), v.end());
         }
 
-        Value(std::initializer_list<std::pair<std::string, Value>> v)
-            : _type(Type::OBJECT)
-        {
-            _value._o = new ObjectContainer(v.begin(), v.end());
-        }
+        Value(std::initializer_list<std::pair<std::string, Value>> v);
 
         template <class T>
-        Value(const std::unordered_map<std::string, T> &v)
-            : _type(Type::OBJECT)
-        {
-            _value._o = new ObjectContainer(v.begin(), v.end());
-        }
+        Value(const std::unordered_map<std::string, T> &v);
 
         static Value createArray();
         static Value createObject();
+        static Value createArray(std::pmr::memory_resource *r);
+        static Value createObject(std::pmr::memory_resource *r);
+        static Value createString(std::string_view s, std::pmr::memory_resource *r);
+
+        /* ресурс, в котором лежит содержимое значения или будет создано
+           новое; ресурс по умолчанию, если значение ресурса не помнит */
+        std::pmr::memory_resource *resource() const;
 
         Type type() const { return _type; }
         bool isUndefined() const { return _type == Type::UNDEFINED; }
@@ -84,10 +208,19 @@ namespace Json
         int asInt(int defaultValue = 0) const;
 
         std::string asString(const std::string &defaultValue = "") const;
-        const std::string &asConstString(const std::string &defaultValue = "") const;
+
+        /* копия строки, для значения другого типа — defaultValue. Строка
+           бывает внутри значения, в документе или ресурсе, поэтому
+           возвращается по значению: const std::string &s = v.asConstString()
+           продлевает жизнь копии. Без копирования строку читает asStringView */
+        std::string asConstString(const std::string &defaultValue = "") const;
+
+        /* строка без копирования; у строк документа указывает в его арену или во входной буфер */
+        std::string_view asStringView(std::string_view defaultValue = {}) const;
 
         std::string asEscapedString(const std::string &defaultValue = "") const;
         bool hasKey(const std::string &str) const;
+        bool hasKey(const Key &key) const;
 
         Value &operator[](const std::string &key);
         Value &operator[](std::string &&key);
@@ -95,9 +228,17 @@ namespace Json
         Value &add(const Value &v);
         Value &add(Value &&v);
 
+        /* добавляет элемент в конец; упакованный массив остаётся упакованным,
+           если v того же типа, что его элементы */
+        void append(const Value &v);
+
         const Value &operator[](const std::string &key) const;
         const Value &operator[](size_t key) const;
 
+        /* поиск с заранее вычисленным хешем ключа, см. key.h */
+        const Value &operator[](const Key &key) const;
+        Value &operator[](const Key &key);
+
         size_t size() const;
 
         /* резервирует память в контейнере */
@@ -114,47 +255,409 @@ namespace Json
 
         bool operator==(const Value &id) const;
 
+        /* компактная запись с упорядоченными ключами, её же выводит operator<< */
         std::string stringifyThis() const;
         std::string prettyStringifyThis() const;
 
-        ObjectContainer *asObject() const;
-        ArrayContainer *asArray() const;
+        /* Содержимое объекта и массива. Неконстантный вызов готовит его к
+           изменению: разделяемый контейнер копируется (см. setCopyOnWrite),
+           упакованный массив распаковывается. Константный только читает,
+           у упакованного массива — элементы только для чтения, не трогая
+           упакованных чисел */
+        ObjectContainer *asObject();
+        const ObjectContainer *asObject() const;
+        ArrayContainer *asArray();
+        const ArrayContainer *asArray() const;
+
+        /* Упакованный массив: числа одного типа (все INTEGER или все NUMBER)
+           лежат подряд в векторе double или int64_t, без Value на элемент.
+           При включённой setPackArrays разборщики и конструктор из
+           std::vector упаковывают такие массивы из packThreshold и более
+           элементов.
+           size, reserve, clear, erase, append, сравнение, копирование и
+           вывод работают с упакованным массивом как есть. Изменение через
+           ссылку на элемент (неконстантные operator[](size_t), add, asArray)
+           сначала распаковывает массив на месте. Константный доступ массив
+           не меняет и безопасен из нескольких потоков: при первом обращении
+           к элементу строится копия элементов в виде Value, которая живёт
+           до изменения массива. Быстрее и без лишней памяти числа читаются
+           через packedNumbers и packedIntegers */
+        static const size_t packThreshold = 16;
+
+        /* упаковывает непустой массив чисел одного типа; true, если массив упакован */
+        bool pack();
+        bool isPacked() const { return _kind == PACKED_NUMBER || _kind == PACKED_INTEGER; }
+
+        /* элементы упакованного массива, size() штук; nullptr, если массив
+           не упакован или упакован с другим типом */
+        const double *packedNumbers() const;
+        const int64_t *packedIntegers() const;
+
+#ifdef __cpp_lib_span
+        std::span<const double> numbers() const { return packedSpan(packedNumbers()); }
+        std::span<const int64_t> integers() const { return packedSpan(packedIntegers()); }
+#endif
 
         void reset();
-        friend std::string &stringifyto(std::string &buff, const Value &v);
 
     private:
-        Type _type;
+        friend class Document;
+        friend class IndexedParser;
+
+        /* чем владеет строковое значение */
+        enum Kind : unsigned char
+        {
+            OWNED,          // _s выделена через new, контейнер принадлежит значению
+            VIEW,           // _v/_size указывают в чужую память, например в арену документа
+            SHARED,         // строка или контейнер со счётчиком ссылок, см. setCopyOnWrite
+            ALLOCATED,      // _v/_size — строка в ресурсе памяти, ресурс и ёмкость лежат перед ней
+            PACKED_NUMBER,  // упакованный массив в _na
+            PACKED_INTEGER, // упакованный массив в _ia
+            INLINE          // INLINE + длина: короткая строка лежит в самом значении
+        };
+
+        /* короткая строка занимает байты _value, _size и _owner */
+        static const size_t inlineCapacity = 14;
+
+        static Value view(const char *data, size_t size);
+
+        std::string_view stringView() const;
+
+        /* упакованный массив из size нулей в ресурсе по умолчанию */
+        template <class T>
+        typename T::value_type *createPacked(size_t size, Kind kind);
+
+        /* переводит упакованный массив в ArrayContainer в том же ресурсе */
+        void unpack();
+
+        /* элементы упакованного массива в виде Value, см. PackedContainer */
+        const ArrayContainer &packedElements() const;
+        void dropPackedElements();
+
+        /* поэлементное сравнение массивов, хотя бы один из которых упакован */
+        bool equalElements(const Value &v) const;
+
+#ifdef __cpp_lib_span
+        template <class T>
+        std::span<const T> packedSpan(const T *p) const
+        {
+            return p ? std::span<const T>(p, size()) : std::span<const T>();
+        }
+#endif
+
+        /* строка для значения типа STRING: короткая — внутри, длинная — в куче;
+           с ресурсом, отличным от ресурса по умолчанию, — любая в ресурсе */
+        void setString(std::string_view s);
+        void setString(std::string_view s, std::pmr::memory_resource *r);
+
+        /* ресурс, из которого выделено содержимое (nullptr — содержимое не
+           выделялось: скаляр, короткая строка, строка документа) */
+        std::pmr::memory_resource *allocationResource() const;
+
+        /* ресурс, отличный от ресурса по умолчанию, в котором должно
+           размещаться присваиваемое значению содержимое, или nullptr */
+        std::pmr::memory_resource *boundResource() const;
+
+        /* Ресурс пустого значения и скаляра хранится в байтах _size и
+           _owner, где помещаются 48 бит адреса (x86-64 и AArch64 без тегов
+           в старших битах указателя). Ресурс с адресом старше не принимают
+           уже Value(r), createArray/createObject/createString и разборщики:
+           они бросают std::invalid_argument, поэтому здесь такого нет */
+        void bind(std::pmr::memory_resource *r)
+        {
+            uint64_t p = (uint64_t)(uintptr_t)r;
+            assert(!(p >> 48) && "memory resource address does not fit in 48 bits");
+            _size = (uint32_t)p;
+            _owner = (uint16_t)(p >> 32);
+        }
+
+        std::pmr::memory_resource *binding() const
+        {
+            return (std::pmr::memory_resource *)(uintptr_t)(((uint64_t)_owner << 32) | _size);
+        }
+
+        /* копирование в ресурс r для конструкторов копии */
+        void copyFrom(const Value &v, std::pmr::memory_resource *r);
+
+        /* освобождает содержимое, не трогая полей */
+        void destroy();
+
+        /* забирает содержимое v, пустое значение и скаляр запоминают ресурс r */
+        void steal(Value &v, std::pmr::memory_resource *r);
+
+        /* перед изменением: разделяемый контейнер копируется, если у него
+           есть другие владельцы */
+        void detach();
 
         union _Value
         {
             ObjectContainer *_o;
             ArrayContainer *_a;
+            NumberContainer *_na;
+            IntegerContainer *_ia;
             std::string *_s;
+            const char *_v;
 
             bool _l;
             long long _i;
             double _d;
-        } _value;
+        } _value{};
+
+        uint32_t _size = 0;
+        uint16_t _owner = 0;
+        Kind _kind = OWNED;
+        Type _type;
 
         static const Value _emptyValue;
     };
 
+    /* Ключ члена объекта, 16 байт: до 15 байт лежит в самом ключе, более
+       длинный — в памяти контейнера или в пуле интернирования (keypool.h).
+       Памятью длинного ключа распоряжается ObjectContainer, поэтому ключи
+       членов нельзя присваивать и переносить в другие объекты */
+    class ObjectKey
+    {
+    public:
+        ObjectKey() : _tag(0) {}
+
+        const char *data() const { return _tag <= inlineCapacity ? _bytes : pointer(); }
+        size_t size() const { return _tag <= inlineCapacity ? _tag : externalSize(); }
+        std::string_view view() const { return std::string_view(data(), size()); }
+        operator std::string_view() const { return view(); }
+
+        /* ключ из пула: одинаковые ключи лежат по одному адресу */
+        bool interned() const { return _tag == INTERNED; }
+
+        /* сначала сравниваются адреса, потом содержимое */
+        bool operator==(std::string_view s) const
+        {
+            std::string_view v = view();
+            return v.size() == s.size() && (v.data() == s.data() || memcmp(v.data(), s.data(), s.size()) == 0);
+        }
+        bool operator!=(std::string_view s) const { return !(*this == s); }
+
+    private:
+        friend class ObjectContainer;
+
+        static const unsigned char inlineCapacity = 15;
+        static const unsigned char INTERNED = 0xFE;
+        static const unsigned char OWNED = 0xFF;
+
+        const char *pointer() const
+        {
+            const char *p;
+            memcpy(&p, _bytes, sizeof(p));
+            return p;
+        }
+
+        size_t externalSize() const
+        {
+            uint32_t n;
+            memcpy(&n, _bytes + sizeof(const char *), sizeof(n));
+            return n;
+        }
+
+        void setInline(std::string_view s)
+        {
+            memcpy(_bytes, s.data(), s.size());
+            _tag = (unsigned char)s.size();
+        }
+
+        void setExternal(const char *p, size_t size, unsigned char tag)
+        {
+            uint32_t n = (uint32_t)size;
+            memcpy(_bytes, &p, sizeof(p));
+            memcpy(_bytes + sizeof(p), &n, sizeof(n));
+            _tag = tag;
+        }
+
+        char _bytes[15];
+        unsigned char _tag; // длина короткого ключа, INTERNED или OWNED
+    };
+
+    /* Члены объекта в порядке вставки, подряд в одном векторе. Небольшие
+       объекты ищут ключ перебором; когда ключей больше hashThreshold,
+       строится хеш-индекс с открытой адресацией, который дальше
+       поддерживается при вставке и удалении; удаление правит в индексе
+       только ячейки сдвинутых членов.
+       Длинные ключи интернируются, если задан пул (setKeyPool).
+       Константные методы ничего не меняют и безопасны из нескольких потоков */
+    class ObjectContainer
+    {
+    public:
+        typedef ObjectKey key_type;
+        typedef Value mapped_type;
+        typedef std::pair<key_type, Value> value_type;
+        typedef std::pmr::vector<value_type>::iterator iterator;
+        typedef std::pmr::vector<value_type>::const_iterator const_iterator;
+        typedef std::pmr::polymorphic_allocator<value_type> allocator_type;
+
+        static const size_t hashThreshold = 16;
+
+        explicit ObjectContainer(const allocator_type &a = {});
+        ObjectContainer(const ObjectContainer &o, const allocator_type &a);
+        ~ObjectContainer();
+
+        ObjectContainer(const ObjectContainer &) = delete;
+        ObjectContainer &operator=(const ObjectContainer &) = delete;
+
+        allocator_type get_allocator() const { return _items.get_allocator(); }
+
+        iterator begin() { return _items.begin(); }
+        iterator end() { return _items.end(); }
+        const_iterator begin() const { return _items.begin(); }
+        const_iterator end() const { return _items.end(); }
+
+        size_t size() const { return _items.size(); }
+        bool empty() const { return _items.empty(); }
+        void reserve(size_t size) { _items.reserve(size); }
+        void clear();
+
+        iterator find(std::string_view key);
+        const_iterator find(std::string_view key) const;
+        size_t count(std::string_view key) const { return find(key) != end(); }
+
+        /* с Key индекс не хеширует ключ заново */
+        iterator find(const Key &key);
+        const_iterator find(const Key &key) const;
+
+        /* добавляет ключ со значением undefined, если его ещё нет;
+           second == false — ключ уже был, возвращается прежний член */
+        std::pair<iterator, bool> try_emplace(std::string_view key);
+        std::pair<iterator, bool> try_emplace(const Key &key);
+
+        /* при повторном ключе остаётся первое значение */
+        template <class T>
+        std::pair<iterator, bool> emplace(std::string_view key, T &&value)
+        {
+            std::pair<iterator, bool> r = try_emplace(key);
+            if (r.second)
+                r.first->second.assign(Value(std::forward<T>(value)));
+            return r;
+        }
+
+        Value &operator[](std::string_view key) { return try_emplace(key).first->second; }
+        Value &operator[](const Key &key) { return try_emplace(key).first->second; }
+
+        size_t erase(std::string_view key);
+        iterator erase(const_iterator i);
+        iterator erase(const_iterator first, const_iterator last);
+
+        /* равны, если совпадают наборы ключей и значения, порядок не важен */
+        bool operator==(const ObjectContainer &o) const;
+        bool operator!=(const ObjectContainer &o) const { return !(*this == o); }
+
+    private:
+        static const size_t npos = SIZE_MAX;
+
+        /* hash нужен, только когда построен индекс */
+        size_t lookup(std::string_view key, uint64_t hash) const;
+        std::pair<iterator, bool> insert(std::string_view key, uint64_t hash);
+        void rebuildIndex(size_t capacity);
+        size_t slot(size_t i) const;
+        void clearSlot(size_t h);
+        void eraseFromIndex(size_t first, size_t last);
+
+        ObjectKey makeKey(std::string_view key);
+        void freeKey(const ObjectKey &key);
+
+        std::pmr::vector<value_type> _items;
+        std::pmr::vector<uint32_t> _index; // номер члена + 1, 0 — свободная ячейка
+    };
+
+    template <class T>
+    Value::Value(const std::unordered_map<std::string, T> &v)
+        : Value(createObject())
+    {
+        for (auto &p : v)
+            _value._o->emplace(p.first, p.second);
+    }
+
+    template <class T>
+    typename T::value_type *Value::createPacked(size_t size, Kind kind)
+    {
+        std::pmr::memory_resource *r = std::pmr::get_default_resource();
+        void *p = r->allocate(sizeof(T), alignof(T));
+        T *c;
+        try
+        {
+            c = new (p) T(size, r);
+        }
+        catch (...)
+        {
+            r->deallocate(p, sizeof(T), alignof(T));
+            throw;
+        }
+        if constexpr (std::is_same_v<T, NumberContainer>)
+            _value._na = c;
+        else
+            _value._ia = c;
+        _type = Type::ARRAY;
+        _kind = kind;
+        return c->data();
+    }
+
     std::ostream &operator<<(std::ostream &os, const Value &value);
 
+    /* Копирование при записи. Пока режим включён, новые массивы, объекты и
+       длинные строки в куче создаются с атомарным счётчиком ссылок: копия
+       такого значения стоит O(1) и делит содержимое с оригиналом, в том числе
+       между потоками, а non-const operator[], add, erase, clear и reserve
+       сначала делают собственную копию (вложенные значения при этом снова
+       разделяются), как и неконстантные asObject и asArray. Содержимое из
+       арены документа копируется целиком. Ссылки и указатели, полученные
+       до копирования значения, по-прежнему указывают в общее содержимое,
+       изменять через них нельзя */
+    void setCopyOnWrite(bool enable);
+    bool copyOnWrite();
+
     std::string escapedString(const std::string &s);
 
     Json::Value parseJson(const char *data, const char *end);
     Json::Value parseJson(const char *data);
+
+    /* контейнеры, длинные ключи и строки результата размещаются в r */
+    Json::Value parseJson(const char *data, const char *end, std::pmr::memory_resource *r);
+
+    /* Разбор поверх прежнего значения target для потока однотипных
+       сообщений: члены объектов с ключами в том же порядке и элементы
+       массивов разбираются на месте, контейнеры сохраняют выделенную
+       память, строки перезаписываются в своём буфере, упакованные массивы
+       заполняются без распаковки. Несовпадающий остаток удаляется и
+       строится заново. Новое содержимое размещается в ресурсе target.
+       Без SIMD и на некорректном входе значение строится заново */
+    void parseInto(Value &target, const char *data, const char *end);
+    void parseInto(Value &target, const char *data);
+
     Value parse_file(const char *fileName);
 
+    /* то же, при ошибке чтения файла возвращает undefined и описание в error */
+    Value parse_file(const char *fileName, std::string &error);
+
+    /* Компактная запись без пробелов и переводов строк. Размер результата
+       оценивается сверху заранее (double — по maxNumberSize), память
+       выделяется один раз, лишнее отрезается. stringifyto дописывает
+       запись в конец buff, sorted упорядочивает ключи объектов */
     std::string &stringifyto(std::string &buff, const Value &v);
     std::string stringify(const Value &v, bool sorted = false);
     std::string prettyStringify(const Value &v, bool sorted = false);
 
+    /* Каноническая запись (RFC 8785) для подписи и хеширования: без пробелов,
+       ключи по возрастанию кодовых единиц UTF-16, числа, в том числе целые, —
+       как double в записи ECMAScript (целые больше 2^53 округляются), в
+       строках экранируются только '"', '\\' и символы меньше 0x20.
+       canonicalStringifyto дописывает запись в конец buff */
+    std::string &canonicalStringifyto(std::string &buff, const Value &v);
+    std::string canonicalStringify(const Value &v);
+
     std::string numberToString(double v);
     std::string numberToString(long long v);
 
+    /* дописывают число в конец buff без временных строк; double выводится
+       кратчайшей записью, которая читается обратно в то же значение */
+    std::string &numberto(std::string &buff, double v);
+    std::string &numberto(std::string &buff, long long v);
+
 } // namespace Json
 
 #endif // VALUE_H
@@ -0,0 +1,119 @@
+#include "document.h"
+#include "valuebuilder.h"
+
+namespace Json
+{
+    ValueBuilder::ValueBuilder(Document *doc, std::pmr::memory_resource *r)
+        : _doc(doc), _resource(r)
+    {
+        reset();
+    }
+
+    void ValueBuilder::reset()
+    {
+        _root.reset();
+        _done = false;
+        _stack.clear();
+        _key.clear();
+        _hasKey = false;
+        _discarded.clear();
+    }
+
+    Value ValueBuilder::release()
+    {
+        Value res = std::move(_root);
+        reset();
+        return res;
+    }
+
+    bool ValueBuilder::onString(std::string_view s)
+    {
+        if (_doc)
+            return scalar(_doc->createString(s));
+        return scalar(Value::createString(s, _resource));
+    }
+
+    bool ValueBuilder::onKey(std::string_view s)
+    {
+        _key.assign(s.data(), s.size());
+        _hasKey = true;
+        return true;
+    }
+
+    bool ValueBuilder::onStartObject()
+    {
+        return beginContainer(_doc ? _doc->createObject() : Value::createObject(_resource));
+    }
+
+    bool ValueBuilder::onStartArray()
+    {
+        return beginContainer(_doc ? _doc->createArray() : Value::createArray(_resource));
+    }
+
+    bool ValueBuilder::scalar(Value &&v)
+    {
+        Value *slot = place();
+        if (slot)
+            *slot = std::move(v);
+        if (_stack.empty())
+            _done = true;
+        return true;
+    }
+
+    bool ValueBuilder::beginContainer(Value &&v)
+    {
+        Value *slot = place();
+        if (slot)
+        {
+            *slot = std::move(v);
+            _stack.push_back(slot);
+        }
+        return true;
+    }
+
+    bool ValueBuilder::endContainer()
+    {
+        if (_stack.empty())
+            return true;
+
+        Value *top = _stack.back();
+        if (top->isArray() && top->size() >= Value::packThreshold && packArrays())
+            top->pack();
+
+        _stack.pop_back();
+        _hasKey = false;
+        if (_stack.empty())
+        {
+            _done = true;
+            _discarded.clear();
+        }
+        return true;
+    }
+
+    // место для очередного значения; nullptr — значение без ключа в объекте
+    Value *ValueBuilder::place()
+    {
+        if (_stack.empty())
+            return &_root;
+
+        Value *top = _stack.back();
+        if (top->isArray())
+        {
+            top->asArray()->emplace_back(_resource);
+            return &top->asArray()->back();
+        }
+
+        if (!_hasKey)
+            return nullptr;
+        _hasKey = false;
+
+        // при повторном ключе остаётся первое значение
+        auto r = top->asObject()->try_emplace(_key);
+        if (r.second)
+            return &r.first->second;
+
+        _discarded.emplace_back();
+        return &_discarded.back();
+    }
+
+} // namespace Json
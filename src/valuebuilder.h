@@ -0,0 +1,62 @@
+#ifndef VALUEBUILDER_H
+#define VALUEBUILDER_H
+
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "value.h"
+
+namespace Json
+{
+    /* Обработчик событий SaxReader, собирающий дерево Value. При повторном
+       ключе остаётся первое значение, как в parseJson; значение без ключа
+       внутри объекта отбрасывается. При doc != nullptr узлы, ключи и строки
+       размещаются в арене документа, иначе в ресурсе памяти r */
+    class ValueBuilder
+    {
+    public:
+        explicit ValueBuilder(Document *doc = nullptr, std::pmr::memory_resource *r = std::pmr::get_default_resource());
+
+        bool onNull() { return scalar(Value()); }
+        bool onBool(bool v) { return scalar(v); }
+        bool onInt(long long v) { return scalar(v); }
+        bool onDouble(double v) { return scalar(v); }
+        bool onString(std::string_view s);
+        bool onKey(std::string_view s);
+        bool onStartObject();
+        bool onEndObject() { return endContainer(); }
+        bool onStartArray();
+        bool onEndArray() { return endContainer(); }
+
+        /* следующая строка будет ключом объекта */
+        bool expectsKey() const { return !_stack.empty() && _stack.back()->isObject() && !_hasKey; }
+
+        /* корневое значение собрано полностью */
+        bool done() const { return _done; }
+
+        /* забирает результат и готовит построитель к следующему значению */
+        Value release();
+
+        void reset();
+
+    private:
+        bool scalar(Value &&v);
+        bool beginContainer(Value &&v);
+        bool endContainer();
+        Value *place();
+
+        Document *_doc;
+        std::pmr::memory_resource *_resource;
+        Value _root;
+        bool _done;
+        std::vector<Value *> _stack; // открытые контейнеры
+        std::string _key;
+        bool _hasKey;
+        std::deque<Value> _discarded; // значения повторных ключей
+    };
+
+} // namespace Json
+
+#endif // VALUEBUILDER_H
@@ -0,0 +1,157 @@
+#include <cassert>
+
+#include "escape.h"
+#include "number.h"
+#include "writer.h"
+
+namespace Json
+{
+    Writer::Writer(std::string &buff)
+        : _buff(buff), _objects(0), _depth(0), _comma(false), _afterKey(false), _complete(false)
+    {
+    }
+
+    char Writer::container() const
+    {
+        if (!_depth)
+            return 0;
+        if (_depth > 64)
+            return '?';
+        return (_objects >> (_depth - 1)) & 1 ? '{' : '[';
+    }
+
+    void Writer::beforeValue()
+    {
+        // в объекте значение только после ключа, вне контейнеров — одно
+        assert(container() == '{' ? _afterKey : !(container() == 0 && _complete));
+        if (_comma)
+            _buff.push_back(',');
+    }
+
+    void Writer::afterValue()
+    {
+        _comma = _depth != 0;
+        _afterKey = false;
+        _complete = _complete || _depth == 0;
+    }
+
+    Writer &Writer::begin(char c, bool object)
+    {
+        beforeValue();
+        _buff.push_back(c);
+        if (_depth < 64)
+        {
+            uint64_t bit = 1ULL << _depth;
+            _objects = object ? _objects | bit : _objects & ~bit;
+        }
+        ++_depth;
+        _comma = false;
+        _afterKey = false;
+        return *this;
+    }
+
+    Writer &Writer::end(char c, bool object)
+    {
+        assert(_depth && (container() == '?' || container() == (object ? '{' : '[')));
+        assert(!_afterKey);
+        (void)object;
+        _buff.push_back(c);
+        --_depth;
+        afterValue();
+        return *this;
+    }
+
+    Writer &Writer::beginObject()
+    {
+        return begin('{', true);
+    }
+
+    Writer &Writer::endObject()
+    {
+        return end('}', true);
+    }
+
+    Writer &Writer::beginArray()
+    {
+        return begin('[', false);
+    }
+
+    Writer &Writer::endArray()
+    {
+        return end(']', false);
+    }
+
+    Writer &Writer::key(std::string_view k)
+    {
+        assert((container() == '{' && !_afterKey) || container() == '?');
+        if (_comma)
+            _buff.push_back(',');
+        string(k);
+        _buff.push_back(':');
+        _comma = false;
+        _afterKey = true;
+        return *this;
+    }
+
+    void Writer::string(std::string_view s)
+    {
+        size_t n = _buff.size();
+        _buff.resize(n + escapedSize(s) + 2);
+        char *p = &_buff[n];
+        *p++ = '\"';
+        p = escapeTo(p, s);
+        *p = '\"';
+    }
+
+    Writer &Writer::null()
+    {
+        beforeValue();
+        _buff.append("null", 4);
+        afterValue();
+        return *this;
+    }
+
+    Writer &Writer::value(bool v)
+    {
+        beforeValue();
+        if (v)
+            _buff.append("true", 4);
+        else
+            _buff.append("false", 5);
+        afterValue();
+        return *this;
+    }
+
+    Writer &Writer::value(long long v)
+    {
+        beforeValue();
+        numberto(_buff, v);
+        afterValue();
+        return *this;
+    }
+
+    Writer &Writer::value(double v)
+    {
+        beforeValue();
+        numberto(_buff, v);
+        afterValue();
+        return *this;
+    }
+
+    Writer &Writer::value(std::string_view v)
+    {
+        beforeValue();
+        string(v);
+        afterValue();
+        return *this;
+    }
+
+    Writer &Writer::value(const Value &v)
+    {
+        beforeValue();
+        stringifyto(_buff, v);
+        afterValue();
+        return *this;
+    }
+
+} // namespace Json
@@ -0,0 +1,80 @@
+#ifndef WRITER_H
+#define WRITER_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "key.h"
+#include "value.h"
+
+namespace Json
+{
+    /* Запись JSON без построения Value: события дописываются сразу в конец
+       buff, строки экранируются и числа записываются так же, как в
+       stringifyto. Запятые и двоеточия расставляются сами:
+           Json::Writer w(buff);
+           w.beginObject().key("id").value(42).key("tags").beginArray();
+           w.value("a").value("b").endArray().endObject();
+       Кроме роста buff память не выделяется, поэтому при повторном
+       использовании буфера (buff.clear()) ответ строится без выделений.
+
+       Порядок вызовов проверяется assert в отладочной сборке: ключ только
+       в объекте и перед значением, парные скобки, одно корневое значение.
+       Стек открытых контейнеров — бит на уровень, глубже 64 уровней тип
+       контейнера не проверяется */
+    class Writer
+    {
+    public:
+        explicit Writer(std::string &buff);
+
+        Writer &beginObject();
+        Writer &endObject();
+        Writer &beginArray();
+        Writer &endArray();
+
+        Writer &key(std::string_view k);
+        Writer &key(const Key &k) { return key(k.view()); }
+
+        Writer &null();
+        Writer &value(bool v);
+        Writer &value(int v) { return value((long long)v); }
+        Writer &value(size_t v) { return value((long long)v); }
+        Writer &value(long v) { return value((long long)v); }
+        Writer &value(long long v);
+        Writer &value(double v);
+        Writer &value(std::string_view v);
+        Writer &value(const char *v) { return value(std::string_view(v)); }
+        Writer &value(const std::string &v) { return value(std::string_view(v)); }
+
+        /* вставляет готовое значение в компактной записи */
+        Writer &value(const Value &v);
+
+        /* корневое значение записано и все контейнеры закрыты */
+        bool complete() const { return _complete && !_depth; }
+
+        /* число открытых контейнеров */
+        size_t depth() const { return _depth; }
+
+    private:
+        // тип открытого контейнера: '{', '[', 0 вне контейнеров,
+        // '?' глубже 64 уровней
+        char container() const;
+
+        void beforeValue();
+        void afterValue();
+        Writer &begin(char c, bool object);
+        Writer &end(char c, bool object);
+        void string(std::string_view s);
+
+        std::string &_buff;
+        uint64_t _objects; // бит уровня: 1 — объект, 0 — массив
+        size_t _depth;
+        bool _comma;    // перед следующим элементом нужна запятая
+        bool _afterKey; // ключ записан, ждём значение
+        bool _complete; // корневое значение записано
+    };
+
+} // namespace Json
+
+#endif // WRITER_H
@@ -0,0 +1,356 @@
+// Проверка MessagePack и CBOR: запись и обратный разбор сверяются со
+// stringify и parseJson.
+//
+//   g++ -std=c++20 -O1 -I../src binary_test.cpp ../src/*.cpp -o binary_test
+//   ./binary_test
+//
+// Выход с кодом 0, если все проверки прошли; иначе печатаются проваленные.
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <sstream>
+#include <string>
+
+#include "binary.h"
+#include "document.h"
+#include "streamwriter.h"
+#include "valuebuilder.h"
+
+using namespace Json;
+
+namespace
+{
+    int fails = 0;
+
+#define CHECK(c)                                                         \
+    do                                                                   \
+    {                                                                    \
+        if (!(c))                                                        \
+        {                                                                \
+            printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #c);          \
+            ++fails;                                                     \
+        }                                                                \
+    } while (0)
+
+    std::string bytes(std::initializer_list<int> b)
+    {
+        std::string s;
+        for (int c : b)
+            s.push_back((char)c);
+        return s;
+    }
+
+    Value mp(const std::string &s) { return parseMsgpack(s.data(), s.data() + s.size()); }
+    Value cb(const std::string &s) { return parseCbor(s.data(), s.data() + s.size()); }
+
+    // разбор s читателем Reader: результат parse и incomplete()
+    template <template <class> class Reader>
+    bool parses(const std::string &s, bool *incomplete = nullptr)
+    {
+        ValueBuilder builder;
+        Reader<ValueBuilder> reader(builder);
+        const char *p = s.data();
+        bool ok = reader.parse(p, s.data() + s.size());
+        if (incomplete)
+            *incomplete = reader.incomplete();
+        return ok;
+    }
+
+    std::mt19937 rng(12345);
+
+    std::string randomJson(int depth)
+    {
+        static const char *numbers[] = {"0", "-1", "123456789", "3.25", "-0.5e10", "1E-5", "12345678901234567890",
+                                        "9223372036854775807", "-9223372036854775808", "1.7976931348623157e308",
+                                        "5e-324", "0.1", "-0", "2.5e+3", "100000000000000000000000"};
+        static const char *strings[] = {"\"\"", "\"a\"", "\"hello\"", "\"\\\"q\\\\\"", "\"\\n\\t\"", "\"\\u00e9\"",
+                                        "\"\\ud83d\\ude00\"", "\"a string long enough to live outside the value\""};
+
+        switch (rng() % (depth > 4 ? 5 : 7))
+        {
+        case 0:
+            return "null";
+        case 1:
+            return rng() % 2 ? "true" : "false";
+        case 2:
+            return numbers[rng() % 15];
+        case 3:
+        case 4:
+            return strings[rng() % 8];
+        case 5:
+        {
+            std::string s = "[";
+            for (int i = 0, n = rng() % 5; i < n; ++i)
+                s += (i ? "," : "") + randomJson(depth + 1);
+            return s + "]";
+        }
+        default:
+        {
+            std::string s = "{";
+            for (int i = 0, n = rng() % 5; i < n; ++i)
+                s += (i ? "," : "") + std::string(strings[rng() % 8]) + ":" + randomJson(depth + 1);
+            return s + "}";
+        }
+        }
+    }
+
+    void testRoundTrip()
+    {
+        for (int i = 0; i < 5000; ++i)
+        {
+            std::string json = randomJson(0);
+            Value v = parseJson(json.data(), json.data() + json.size());
+            std::string ref = stringify(v);
+            std::string m = toMsgpack(v), c = toCbor(v);
+
+            Value a = mp(m), b = cb(c);
+            CHECK(stringify(a) == ref);
+            CHECK(stringify(b) == ref);
+            CHECK(a.type() == v.type() && b.type() == v.type());
+
+            // запись через StreamWriter совпадает с записью в строку
+            std::ostringstream os1, os2;
+            {
+                StreamWriter w1(os1), w2(os2);
+                writeMsgpack(w1, v);
+                writeCbor(w2, v);
+            }
+            CHECK(os1.str() == m && os2.str() == c);
+
+            Document doc;
+            CHECK(stringify(doc.parseMsgpack(m.data(), m.data() + m.size(), true)) == ref);
+            CHECK(stringify(doc.parseCbor(c.data(), c.data() + c.size())) == ref);
+
+            // оборванный вход — не ошибка формата
+            for (size_t k = 0; k < m.size(); k += 1 + m.size() / 7)
+            {
+                bool incomplete = false;
+                CHECK(!parses<MsgpackReader>(m.substr(0, k), &incomplete) && incomplete);
+            }
+            for (size_t k = 0; k < c.size(); k += 1 + c.size() / 7)
+            {
+                bool incomplete = false;
+                CHECK(!parses<CborReader>(c.substr(0, k), &incomplete) && incomplete);
+            }
+        }
+    }
+
+    void testIntegers()
+    {
+        const long long values[] = {0, 1, 23, 24, 127, 128, 255, 256, 65535, 65536, 4294967295LL, 4294967296LL,
+                                    INT64_MAX, -1, -24, -25, -32, -33, -128, -129, -32768, -32769, INT32_MIN,
+                                    (long long)INT32_MIN - 1, INT64_MIN};
+        for (long long x : values)
+        {
+            Value v(x);
+            Value a = mp(toMsgpack(v)), b = cb(toCbor(v));
+            CHECK(a.isInteger() && a.asLongLong() == x);
+            CHECK(b.isInteger() && b.asLongLong() == x);
+            CHECK(stringify(a) == stringify(parseJson(stringify(v).c_str())));
+        }
+
+        // больше int64 — double, как в parseJson
+        CHECK(mp(bytes({0xcf, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff})).asNumber() == 18446744073709551615.0);
+        CHECK(cb(bytes({0x1b, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff})).asNumber() == 18446744073709551615.0);
+        CHECK(cb(bytes({0x3b, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff})).asNumber() == -18446744073709551616.0);
+        CHECK(stringify(mp(bytes({0xcf, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff}))) ==
+              stringify(parseJson("18446744073709551615")));
+    }
+
+    void testDoubles()
+    {
+        const double values[] = {0.1, -0.0, 5e-324, 2.2250738585072014e-308, 1.7976931348623157e308, 1.0, 3.0, -2.5,
+                                 1e21, 123456789.123456789};
+        for (double x : values)
+        {
+            Value v(x);
+            Value a = mp(toMsgpack(v)), b = cb(toCbor(v));
+            double da = a.asNumber(), db = b.asNumber();
+            CHECK(a.isFloatingPoint() && memcmp(&x, &da, sizeof(x)) == 0);
+            CHECK(b.isFloatingPoint() && memcmp(&x, &db, sizeof(x)) == 0);
+            CHECK(stringify(a) == stringify(v) && stringify(b) == stringify(v));
+        }
+
+        CHECK(toCbor(Value(1.1)) == bytes({0xfb, 0x3f, 0xf1, 0x99, 0x99, 0x99, 0x99, 0x99, 0x9a}));
+        CHECK(mp(bytes({0xca, 0x3f, 0xc0, 0x00, 0x00})).asNumber() == 1.5);
+
+        // float16 и float32 CBOR, RFC 8949 приложение A
+        CHECK(cb(bytes({0xf9, 0x3c, 0x00})).asNumber() == 1.0);
+        CHECK(cb(bytes({0xf9, 0x7b, 0xff})).asNumber() == 65504.0);
+        CHECK(cb(bytes({0xf9, 0x00, 0x01})).asNumber() == 5.960464477539063e-8);
+        CHECK(cb(bytes({0xf9, 0x04, 0x00})).asNumber() == 0.00006103515625);
+        CHECK(cb(bytes({0xf9, 0xc4, 0x00})).asNumber() == -4.0);
+        CHECK(cb(bytes({0xf9, 0x7c, 0x00})).isUndefined()); // бесконечность, как Value(INFINITY)
+        CHECK(cb(bytes({0xf9, 0x7e, 0x00})).isUndefined());
+        CHECK(cb(bytes({0xfa, 0x47, 0xc3, 0x50, 0x00})).asNumber() == 100000.0);
+    }
+
+    void testKnownEncodings()
+    {
+        Value v = parseJson("{\"a\":[1,-1,true,null,\"x\"]}");
+        CHECK(toMsgpack(v) == bytes({0x81, 0xa1, 'a', 0x95, 0x01, 0xff, 0xc3, 0xc0, 0xa1, 'x'}));
+        CHECK(toCbor(v) == bytes({0xa1, 0x61, 'a', 0x85, 0x01, 0x20, 0xf5, 0xf6, 0x61, 'x'}));
+        CHECK(toMsgpack(Value(1000LL)) == bytes({0xcd, 0x03, 0xe8}));
+        CHECK(toCbor(Value(1000LL)) == bytes({0x19, 0x03, 0xe8}));
+
+        CHECK(stringify(mp(bytes({0x81, 0xd0, 0x85, 0xc2}))) == "{\"-123\":false}");
+        CHECK(stringify(mp(bytes({0xc4, 0x02, 'h', 'i'}))) == "\"hi\"");
+        CHECK(stringify(cb(bytes({0xc1, 0x1a, 0x51, 0x4b, 0x67, 0xb0}))) == "1363896240");
+        CHECK(stringify(cb(bytes({0xa2, 0x01, 0x02, 0x03, 0x04}))) == "{\"1\":2,\"3\":4}");
+        CHECK(stringify(cb(bytes({0xf7}))) == "null");
+    }
+
+    void testIndefiniteLength()
+    {
+        CHECK(stringify(cb(bytes({0x9f, 0xff}))) == "[]");
+        CHECK(stringify(cb(bytes({0x9f, 0x01, 0x82, 0x02, 0x03, 0x9f, 0x04, 0x05, 0xff, 0xff}))) == "[1,[2,3],[4,5]]");
+        CHECK(stringify(cb(bytes({0x83, 0x01, 0x9f, 0x02, 0x03, 0xff, 0x82, 0x04, 0x05}))) == "[1,[2,3],[4,5]]");
+        CHECK(stringify(cb(bytes({0xbf, 0x61, 'a', 0x01, 0x61, 'b', 0x9f, 0x02, 0x03, 0xff, 0xff}))) ==
+              "{\"a\":1,\"b\":[2,3]}");
+        CHECK(stringify(cb(bytes({0x7f, 0x65, 's', 't', 'r', 'e', 'a', 0x64, 'm', 'i', 'n', 'g', 0xff}))) ==
+              "\"streaming\"");
+        CHECK(stringify(cb(bytes({0x5f, 0x42, 0x01, 0x02, 0x43, 0x03, 0x04, 0x05, 0xff}))) ==
+              "\"\\u0001\\u0002\\u0003\\u0004\\u0005\"");
+
+        // без BREAK — обрыв, кусок другого типа — ошибка
+        bool incomplete = false;
+        CHECK(!parses<CborReader>(bytes({0x9f, 0x01, 0x02}), &incomplete) && incomplete);
+        CHECK(!parses<CborReader>(bytes({0x7f, 0x61, 'a'}), &incomplete) && incomplete);
+        CHECK(!parses<CborReader>(bytes({0x5f, 0x61, 'a', 0xff}), &incomplete) && !incomplete);
+    }
+
+    void testPackedArrays()
+    {
+        setPackArrays(true);
+
+        std::string ints = "[";
+        for (int i = 0; i < 1000; ++i)
+            ints += (i ? "," : "") + std::to_string(i * 1000003LL - 500000000);
+        ints += "]";
+        Value v = parseJson(ints.c_str());
+        CHECK(v.packedIntegers());
+        Value a = mp(toMsgpack(v)), b = cb(toCbor(v));
+        CHECK(stringify(a) == ints && stringify(b) == ints);
+        CHECK(a.packedIntegers() && b.packedIntegers());
+
+        std::string numbers = "[";
+        for (int i = 0; i < 1000; ++i)
+            numbers += (i ? "," : "") + std::to_string(i) + ".5";
+        numbers += "]";
+        Value w = parseJson(numbers.c_str());
+        CHECK(w.packedNumbers());
+        a = mp(toMsgpack(w));
+        b = cb(toCbor(w));
+        CHECK(stringify(a) == stringify(w) && stringify(b) == stringify(w));
+        CHECK(a.packedNumbers() && b.packedNumbers());
+
+        setPackArrays(false);
+    }
+
+    void testErrors()
+    {
+        for (const std::string &s : {bytes({0xc1}), bytes({0xd4, 0x01, 0x02}), bytes({0x81, 0x90, 0x01}),
+                                     bytes({0x81, 0xcb, 0, 0, 0, 0, 0, 0, 0, 0, 0x01})})
+        {
+            bool incomplete = true;
+            CHECK(!parses<MsgpackReader>(s, &incomplete) && !incomplete);
+            CHECK(mp(s).isUndefined());
+        }
+
+        for (const std::string &s : {bytes({0xfc}), bytes({0xf8, 0x20}), bytes({0x1c}), bytes({0xff}),
+                                     bytes({0xa1, 0x80, 0x01}), bytes({0x3f})})
+        {
+            bool incomplete = true;
+            CHECK(!parses<CborReader>(s, &incomplete) && !incomplete);
+            CHECK(cb(s).isUndefined());
+        }
+
+        // ложная длина не выделяет память, вход считается оборванным
+        bool incomplete = false;
+        CHECK(!parses<MsgpackReader>(bytes({0xdd, 0xff, 0xff, 0xff, 0xff, 0x01}), &incomplete) && incomplete);
+        CHECK(!parses<CborReader>(bytes({0x9b, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff}), &incomplete) &&
+              incomplete);
+    }
+
+    void testDepthLimit()
+    {
+        const size_t limit = BinaryReader<ValueBuilder>::maxDepth;
+
+        // n вложенных массивов из одного элемента вокруг null
+        auto nested = [](size_t n, char head, char null) { return std::string(n, head) + null; };
+
+        std::string m = nested(limit, (char)0x91, (char)0xc0);
+        std::string c = nested(limit, (char)0x81, (char)0xf6);
+        CHECK(mp(m).isArray() && cb(c).isArray());
+        CHECK(toMsgpack(mp(m)) == m && toCbor(cb(c)) == c);
+
+        // глубже предела — ошибка формата, а не обрыв
+        bool incomplete = true;
+        CHECK(!parses<MsgpackReader>(nested(limit + 1, (char)0x91, (char)0xc0), &incomplete) && !incomplete);
+        CHECK(!parses<CborReader>(nested(limit + 1, (char)0x81, (char)0xf6), &incomplete) && !incomplete);
+        CHECK(!parses<CborReader>(nested(limit + 1, (char)0x9f, (char)0xf6), &incomplete) && !incomplete);
+        CHECK(!parses<CborReader>(nested(limit + 1, (char)0xc6, (char)0xf6), &incomplete) && !incomplete);
+
+        // map из одного члена с вложенными значениями
+        std::string maps;
+        for (size_t i = 0; i <= limit; ++i)
+            maps += bytes({0x81, 0xa1, 'k'});
+        maps += (char)0xc0;
+        CHECK(!parses<MsgpackReader>(maps, &incomplete) && !incomplete);
+
+        // вход из одних заголовков не переполняет стек
+        CHECK(mp(std::string(1 << 20, (char)0x91)).isUndefined());
+        CHECK(cb(std::string(1 << 20, (char)0x9f)).isUndefined());
+        CHECK(cb(std::string(1 << 20, (char)0xc6)).isUndefined());
+
+        // глубина считается заново для каждого значения потока
+        std::string stream = m + m;
+        ValueBuilder builder;
+        MsgpackReader<ValueBuilder> reader(builder);
+        const char *p = stream.data();
+        CHECK(reader.parse(p, stream.data() + stream.size()));
+        builder.release();
+        CHECK(reader.parse(p, stream.data() + stream.size()));
+        CHECK(p == stream.data() + stream.size());
+    }
+
+    void testStream()
+    {
+        std::string buff;
+        for (int i = 0; i < 10; ++i)
+            msgpackto(buff, parseJson(("[" + std::to_string(i) + ",\"x\"]").c_str()));
+
+        ValueBuilder builder;
+        MsgpackReader<ValueBuilder> reader(builder);
+        const char *p = buff.data();
+        int n = 0;
+        while (reader.parse(p, buff.data() + buff.size()))
+        {
+            Value v = builder.release();
+            CHECK(v[0].asLongLong() == n);
+            ++n;
+        }
+        CHECK(n == 10 && reader.incomplete() && p == buff.data() + buff.size());
+    }
+
+} // namespace
+
+int main()
+{
+    testRoundTrip();
+    testIntegers();
+    testDoubles();
+    testKnownEncodings();
+    testIndefiniteLength();
+    testPackedArrays();
+    testErrors();
+    testDepthLimit();
+    testStream();
+
+    if (fails)
+        printf("%d checks failed\n", fails);
+    return fails != 0;
+}
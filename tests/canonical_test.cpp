@@ -0,0 +1,152 @@
+// Проверка канонической записи (RFC 8785): таблица чисел из приложения B,
+// порядок ключей по кодовым единицам UTF-16 и пример целиком из 3.2.
+//
+//   g++ -std=c++20 -O1 -I../src canonical_test.cpp ../src/*.cpp -o canonical_test
+//   ./canonical_test
+//
+// Выход с кодом 0, если все проверки прошли; иначе печатаются проваленные.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "number.h"
+#include "value.h"
+
+using namespace Json;
+
+namespace
+{
+    int fails = 0;
+
+#define CHECK(c)                                                         \
+    do                                                                   \
+    {                                                                    \
+        if (!(c))                                                        \
+        {                                                                \
+            printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #c);          \
+            ++fails;                                                     \
+        }                                                                \
+    } while (0)
+
+    std::string canonical(uint64_t bits)
+    {
+        double d;
+        memcpy(&d, &bits, sizeof(d));
+        char buff[32];
+        return std::string(buff, writeCanonicalNumber(buff, d));
+    }
+
+    // RFC 8785, приложение B; NaN и бесконечности в JSON не допускаются
+    void testNumbers()
+    {
+        static const struct
+        {
+            uint64_t bits;
+            const char *text;
+        } table[] = {
+            {0x0000000000000000, "0"},
+            {0x8000000000000000, "0"},
+            {0x0000000000000001, "5e-324"},
+            {0x8000000000000001, "-5e-324"},
+            {0x7fefffffffffffff, "1.7976931348623157e+308"},
+            {0xffefffffffffffff, "-1.7976931348623157e+308"},
+            {0x4340000000000000, "9007199254740992"},
+            {0xc340000000000000, "-9007199254740992"},
+            {0x4430000000000000, "295147905179352830000"},
+            {0x44b52d02c7e14af5, "9.999999999999997e+22"},
+            {0x44b52d02c7e14af6, "1e+23"},
+            {0x44b52d02c7e14af7, "1.0000000000000001e+23"},
+            {0x444b1ae4d6e2ef4e, "999999999999999700000"},
+            {0x444b1ae4d6e2ef4f, "999999999999999900000"},
+            {0x444b1ae4d6e2ef50, "1e+21"},
+            {0x3eb0c6f7a0b5ed8c, "9.999999999999997e-7"},
+            {0x3eb0c6f7a0b5ed8d, "0.000001"},
+            {0x41b3de4355555553, "333333333.3333332"},
+            {0x41b3de4355555554, "333333333.33333325"},
+            {0x41b3de4355555555, "333333333.3333333"},
+            {0x41b3de4355555556, "333333333.3333334"},
+            {0x41b3de4355555557, "333333333.33333343"},
+            {0xbecbf647612f3696, "-0.0000033333333333333333"},
+            {0x43143ff3c1cb0959, "1424953923781206.2"},
+        };
+
+        for (const auto &t : table)
+        {
+            std::string s = canonical(t.bits);
+            if (s != t.text)
+            {
+                printf("FAIL %016llx: %s, expected %s\n", (unsigned long long)t.bits, s.c_str(), t.text);
+                ++fails;
+            }
+        }
+
+        // целые записываются как double того же значения
+        CHECK(canonicalStringify(parseJson("[1,-0,100,1e2,123456789012345678]")) ==
+              "[1,0,100,100,123456789012345680]");
+    }
+
+    // RFC 8785, 3.2.3: ключи сравниваются по кодовым единицам UTF-16, поэтому
+    // суррогатная пара U+1F600 идёт раньше U+FB33, хотя в UTF-8 позже
+    void testKeyOrder()
+    {
+        const char *input = "{\n"
+                            "  \"\\u20ac\": \"Euro Sign\",\n"
+                            "  \"\\r\": \"Carriage Return\",\n"
+                            "  \"\\ufb33\": \"Hebrew Letter Dalet With Dagesh\",\n"
+                            "  \"1\": \"One\",\n"
+                            "  \"\\ud83d\\ude00\": \"Emoji: Grinning Face\",\n"
+                            "  \"\\u0080\": \"Control\",\n"
+                            "  \"\\u00f6\": \"Latin Small Letter O With Diaeresis\"\n"
+                            "}";
+        const char *expected = "{\"\\r\":\"Carriage Return\","
+                               "\"1\":\"One\","
+                               "\"\xc2\x80\":\"Control\","
+                               "\"\xc3\xb6\":\"Latin Small Letter O With Diaeresis\","
+                               "\"\xe2\x82\xac\":\"Euro Sign\","
+                               "\"\xf0\x9f\x98\x80\":\"Emoji: Grinning Face\","
+                               "\"\xef\xac\xb3\":\"Hebrew Letter Dalet With Dagesh\"}";
+        CHECK(canonicalStringify(parseJson(input)) == expected);
+
+        // вложенные объекты сортируются тоже, массивы сохраняют порядок
+        CHECK(canonicalStringify(parseJson("{\"b\":[{\"y\":1,\"x\":2}],\"a\":{\"d\":0,\"c\":0}}")) ==
+              "{\"a\":{\"c\":0,\"d\":0},\"b\":[{\"x\":2,\"y\":1}]}");
+    }
+
+    // RFC 8785, 3.2.2 и 3.2.3: пример целиком
+    void testExample()
+    {
+        const char *input = "{\n"
+                            "  \"numbers\": [333333333.33333329, 1E30, 4.50,\n"
+                            "              2e-3, 0.000000000000000000000000001],\n"
+                            "  \"string\": \"\\u20ac$\\u000F\\u000aA'\\u0042\\u0022\\u005c\\\\\\\"\\/\",\n"
+                            "  \"literals\": [null, true, false]\n"
+                            "}";
+        const char *expected = "{\"literals\":[null,true,false],"
+                               "\"numbers\":[333333333.3333333,1e+30,4.5,0.002,1e-27],"
+                               "\"string\":\"\xe2\x82\xac$\\u000f\\nA'B\\\"\\\\\\\\\\\"/\"}";
+        std::string s = canonicalStringify(parseJson(input));
+        if (s != expected)
+        {
+            printf("FAIL example: %s\n", s.c_str());
+            ++fails;
+        }
+
+        // canonicalStringifyto дописывает к buff
+        std::string buff = "x";
+        CHECK(canonicalStringifyto(buff, parseJson("{\"b\":1,\"a\":2}")) == "x{\"a\":2,\"b\":1}");
+    }
+
+} // namespace
+
+int main()
+{
+    testNumbers();
+    testKeyOrder();
+    testExample();
+
+    if (fails)
+        printf("%d checks failed\n", fails);
+    return fails != 0;
+}
@@ -0,0 +1,221 @@
+// Проверка ObjectContainer: случайные вставки и удаления (по ключу, по
+// итератору, диапазоном) сверяются со списком пар в порядке вставки.
+// Размер объекта ходит вокруг hashThreshold, так что индекс строится,
+// правится при удалении и сбрасывается.
+//
+//   g++ -std=c++20 -O1 -I../src objectcontainer_test.cpp ../src/*.cpp -o objectcontainer_test
+//   ./objectcontainer_test
+//
+// Выход с кодом 0, если все проверки прошли; иначе печатаются проваленные.
+
+#include <cstdio>
+#include <memory_resource>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "value.h"
+
+using namespace Json;
+
+namespace
+{
+    int fails = 0;
+
+#define CHECK(c)                                                         \
+    do                                                                   \
+    {                                                                    \
+        if (!(c))                                                        \
+        {                                                                \
+            printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #c);          \
+            ++fails;                                                     \
+        }                                                                \
+    } while (0)
+
+    typedef std::vector<std::pair<std::string, int>> Reference;
+
+    // короткие ключи хранятся в самом ключе, длинные — в ресурсе контейнера
+    std::vector<std::string> keys()
+    {
+        std::vector<std::string> k;
+        for (int i = 0; i < 96; ++i)
+            k.push_back(i % 3 ? "k" + std::to_string(i) : "a rather long key number " + std::to_string(i));
+        return k;
+    }
+
+    Reference::iterator findReference(Reference &ref, const std::string &key)
+    {
+        for (auto i = ref.begin(); i != ref.end(); ++i)
+        {
+            if (i->first == key)
+                return i;
+        }
+        return ref.end();
+    }
+
+    // порядок, размер и поиск каждого ключа, в том числе удалённых
+    bool same(const ObjectContainer &o, Reference &ref, const std::vector<std::string> &all)
+    {
+        if (o.size() != ref.size())
+            return false;
+
+        size_t i = 0;
+        for (const auto &p : o)
+        {
+            if (p.first.view() != ref[i].first || p.second.asInt() != ref[i].second)
+                return false;
+            ++i;
+        }
+
+        for (const std::string &k : all)
+        {
+            auto r = findReference(ref, k);
+            auto f = o.find(k);
+            auto fk = o.find(Key(k));
+            if ((r == ref.end()) != (f == o.end()) || f != fk || o.count(k) != (r != ref.end()))
+                return false;
+            if (f != o.end() && (f->first.view() != k || f->second.asInt() != r->second))
+                return false;
+        }
+        return true;
+    }
+
+    void run(std::pmr::memory_resource *r, unsigned seed)
+    {
+        const std::vector<std::string> all = keys();
+        std::mt19937 rng(seed);
+        auto pick = [&](size_t n) { return std::uniform_int_distribution<size_t>(0, n - 1)(rng); };
+
+        ObjectContainer o(r);
+        Reference ref;
+        int next = 0;
+
+        // размер колеблется между целями по обе стороны hashThreshold
+        size_t target = ObjectContainer::hashThreshold;
+        for (int step = 0; step < 4000; ++step)
+        {
+            if (step % 200 == 0)
+                target = 4 + pick(ObjectContainer::hashThreshold * 4);
+
+            bool grow = ref.size() < target ? pick(4) != 0 : pick(4) == 0;
+            if (grow || ref.empty())
+            {
+                const std::string &k = all[pick(all.size())];
+                int v = next++;
+                auto r = findReference(ref, k);
+                switch (pick(3))
+                {
+                case 0:
+                {
+                    // повторный ключ оставляет первое значение
+                    auto e = o.emplace(k, v);
+                    CHECK(e.second == (r == ref.end()));
+                    if (r == ref.end())
+                        ref.emplace_back(k, v);
+                    break;
+                }
+                case 1:
+                    o[k] = v;
+                    if (r == ref.end())
+                        ref.emplace_back(k, v);
+                    else
+                        r->second = v;
+                    break;
+                default:
+                {
+                    auto e = o.try_emplace(Key(k));
+                    CHECK(e.second == (r == ref.end()) && e.first->first.view() == k);
+                    if (e.second)
+                    {
+                        e.first->second = v;
+                        ref.emplace_back(k, v);
+                    }
+                    break;
+                }
+                }
+            }
+            else
+            {
+                switch (pick(3))
+                {
+                case 0:
+                {
+                    // и ключи, которых нет
+                    const std::string &k = all[pick(all.size())];
+                    auto r = findReference(ref, k);
+                    CHECK(o.erase(k) == (r != ref.end() ? 1u : 0u));
+                    if (r != ref.end())
+                        ref.erase(r);
+                    break;
+                }
+                case 1:
+                {
+                    size_t i = pick(ref.size());
+                    auto next = o.erase(o.begin() + i);
+                    CHECK(next - o.begin() == (ptrdiff_t)i);
+                    ref.erase(ref.begin() + i);
+                    break;
+                }
+                default:
+                {
+                    // диапазон, в том числе пустой и до конца
+                    size_t first = pick(ref.size() + 1);
+                    size_t last = first + pick(std::min<size_t>(ref.size() - first, 12) + 1);
+                    auto next = o.erase(o.begin() + first, o.begin() + last);
+                    CHECK(next - o.begin() == (ptrdiff_t)first);
+                    ref.erase(ref.begin() + first, ref.begin() + last);
+                    break;
+                }
+                }
+            }
+
+            if (!same(o, ref, all))
+            {
+                printf("FAIL seed %u step %d size %zu\n", seed, step, ref.size());
+                ++fails;
+                return;
+            }
+        }
+
+        o.clear();
+        ref.clear();
+        CHECK(same(o, ref, all));
+    }
+
+    // то же через Value: operator[], hasKey и удаление после отделения копии
+    void testValue()
+    {
+        Value v = Value::createObject();
+        for (int i = 0; i < 40; ++i)
+            v["key" + std::to_string(i)] = i;
+
+        ObjectContainer *o = v.asObject();
+        o->erase(o->begin() + 5, o->begin() + 30);
+        CHECK(v.size() == 15);
+        CHECK(!v.hasKey("key5") && !v.hasKey("key29") && v.hasKey("key4") && v.hasKey("key30"));
+        CHECK(v["key30"].asInt() == 30 && v.size() == 15);
+
+        for (int i = 40; i < 60; ++i)
+            v["key" + std::to_string(i)] = i;
+        CHECK(v.size() == 35 && v["key59"].asInt() == 59 && v["key0"].asInt() == 0);
+    }
+
+} // namespace
+
+int main()
+{
+    for (unsigned seed = 1; seed <= 8; ++seed)
+        run(std::pmr::get_default_resource(), seed);
+
+    // длинные ключи и значения в отдельном ресурсе
+    std::pmr::unsynchronized_pool_resource pool;
+    for (unsigned seed = 100; seed <= 104; ++seed)
+        run(&pool, seed);
+
+    testValue();
+
+    if (fails)
+        printf("%d checks failed\n", fails);
+    return fails != 0;
+}
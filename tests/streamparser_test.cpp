@@ -0,0 +1,204 @@
+// Проверка StreamParser: случайные документы подаются фрагментами по 1..7
+// байт и сверяются с parseJson для того же текста целиком. Разрезы
+// приходятся на середину строк, escape-последовательностей, чисел и
+// литералов.
+//
+//   g++ -std=c++20 -O1 -I../src streamparser_test.cpp ../src/*.cpp -o streamparser_test
+//   ./streamparser_test
+//
+// Выход с кодом 0, если все проверки прошли; иначе печатаются проваленные.
+
+#include <cstdio>
+#include <random>
+#include <string>
+
+#include "streamparser.h"
+
+using namespace Json;
+
+namespace
+{
+    int fails = 0;
+
+#define CHECK(c)                                                         \
+    do                                                                   \
+    {                                                                    \
+        if (!(c))                                                        \
+        {                                                                \
+            printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #c);          \
+            ++fails;                                                     \
+        }                                                                \
+    } while (0)
+
+    class Generator
+    {
+    public:
+        explicit Generator(unsigned seed) : _rng(seed) {}
+
+        std::string document()
+        {
+            std::string s;
+            space(s);
+            value(s, 0);
+            space(s);
+            return s;
+        }
+
+    private:
+        size_t pick(size_t n) { return std::uniform_int_distribution<size_t>(0, n - 1)(_rng); }
+
+        void space(std::string &s)
+        {
+            static const char ws[] = " \t\n\r";
+            for (size_t n = pick(4) == 0 ? pick(3) : 0; n; --n)
+                s += ws[pick(4)];
+        }
+
+        void value(std::string &s, int depth)
+        {
+            switch (pick(depth < 5 ? 8 : 5))
+            {
+            case 0:
+                s += (const char *[]){"null", "true", "false"}[pick(3)];
+                break;
+            case 1:
+            case 2:
+                number(s);
+                break;
+            case 3:
+            case 4:
+                string(s);
+                break;
+            case 5:
+            case 6:
+            {
+                s += '[';
+                for (size_t i = 0, n = pick(6); i < n; ++i)
+                {
+                    if (i)
+                        s += ',';
+                    space(s);
+                    value(s, depth + 1);
+                    space(s);
+                }
+                s += ']';
+                break;
+            }
+            default:
+            {
+                s += '{';
+                for (size_t i = 0, n = pick(6); i < n; ++i)
+                {
+                    if (i)
+                        s += ',';
+                    space(s);
+                    string(s);
+                    space(s);
+                    s += ':';
+                    space(s);
+                    value(s, depth + 1);
+                    space(s);
+                }
+                s += '}';
+                break;
+            }
+            }
+        }
+
+        void number(std::string &s)
+        {
+            if (pick(3) == 0)
+                s += '-';
+            if (pick(5) == 0)
+                s += '0';
+            else
+                s += std::to_string(1 + pick(pick(2) ? 1000 : 1000000000));
+            if (pick(3) == 0)
+                s += "." + std::to_string(pick(100000));
+            if (pick(5) == 0)
+                s += std::string(pick(2) ? "e" : "E") + (const char *[]){"", "+", "-"}[pick(3)] + std::to_string(pick(30));
+            if (pick(20) == 0)
+                s += "12345678901234567890"; // за пределами int64_t
+        }
+
+        void string(std::string &s)
+        {
+            static const char *pieces[] = {
+                "a", "key", "long string part ", "\\\"", "\\\\", "\\/", "\\b", "\\f", "\\n", "\\r", "\\t",
+                "\\u0041", "\\u00e9", "\\u20ac", "\\ud83d\\ude00", "\\u0000", "\xc3\xa9", "\xe2\x82\xac",
+                "\xf0\x9f\x98\x80", "0123456789abcdef"};
+            s += '\"';
+            for (size_t n = pick(8); n; --n)
+                s += pieces[pick(sizeof(pieces) / sizeof(pieces[0]))];
+            s += '\"';
+        }
+
+        std::mt19937 _rng;
+    };
+
+    // текст фрагментами случайной длины 1..7
+    Value feedChunks(StreamParser &p, const std::string &text, std::mt19937 &rng)
+    {
+        std::uniform_int_distribution<size_t> chunk(1, 7);
+        for (size_t i = 0; i < text.size();)
+        {
+            size_t n = std::min(chunk(rng), text.size() - i);
+            p.feed(text.data() + i, n);
+            i += n;
+        }
+        return p.finish();
+    }
+
+    void testRandom()
+    {
+        Generator g(7);
+        std::mt19937 rng(11);
+        StreamParser p; // один разборщик на все документы: finish готовит следующий
+        for (int i = 0; i < 3000; ++i)
+        {
+            std::string text = g.document();
+            Value expected = parseJson(text.data(), text.data() + text.size());
+            Value v = feedChunks(p, text, rng);
+            if (!(v == expected) || stringify(v) != stringify(expected))
+            {
+                printf("FAIL document %d: %s\n", i, text.c_str());
+                ++fails;
+            }
+        }
+    }
+
+    // по байту: каждый разрез внутри лексемы
+    void testBytewise()
+    {
+        const std::string text = "{\"s\":\"x\\u00e9\\ud83d\\ude00\\n\\\"y\",\"n\":[-0.5e-3,12345678901234567890,0,-7],"
+                                  "\"l\":[true,false,null],\"o\":{\"\":{}},\"a\":[[],[[1]]]}";
+        Value expected = parseJson(text.data(), text.data() + text.size());
+
+        StreamParser p;
+        for (char c : text)
+            p.feed(&c, 1);
+        CHECK(p.done());
+        CHECK(p.finish() == expected);
+
+        // корневое число заканчивается только с концом ввода
+        p.feed("-12", 3);
+        p.feed(".5", 2);
+        CHECK(!p.done());
+        CHECK(p.finish().asNumber() == -12.5);
+
+        // остаток после корневого значения игнорируется
+        p.feed("[1] [2]", 7);
+        CHECK(stringify(p.finish()) == "[1]");
+    }
+
+} // namespace
+
+int main()
+{
+    testRandom();
+    testBytewise();
+
+    if (fails)
+        printf("%d checks failed\n", fails);
+    return fails != 0;
+}
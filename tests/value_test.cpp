@@ -0,0 +1,185 @@
+// Проверка Value: ресурсы памяти, копирование при записи, упаковка
+// массивов.
+//
+//   g++ -std=c++20 -O1 -I../src value_test.cpp ../src/*.cpp -o value_test
+//   ./value_test
+//
+// Выход с кодом 0, если все проверки прошли; иначе печатаются проваленные.
+
+#include <cstdio>
+#include <cstring>
+#include <memory_resource>
+#include <new>
+#include <stdexcept>
+#include <string>
+
+#include "value.h"
+
+using namespace Json;
+
+namespace
+{
+    int fails = 0;
+
+#define CHECK(c)                                                         \
+    do                                                                   \
+    {                                                                    \
+        if (!(c))                                                        \
+        {                                                                \
+            printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #c);          \
+            ++fails;                                                     \
+        }                                                                \
+    } while (0)
+
+    const char *document = "{\"a\":[1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18],"
+                           "\"b\":\"a long string that is allocated in the resource\","
+                           "\"c\":[{\"x\":[1.5,2.5]},\"yy\",null],\"d\":{\"e\":{\"f\":[true,false]}}}";
+
+    // f(r) на ограниченных ресурсах всех размеров до 4 КБ: нехватка памяти
+    // даёт bad_alloc, а не падение; возвращает число брошенных исключений
+    template <class F>
+    int exhaust(F f)
+    {
+        int thrown = 0;
+        for (size_t n = 8; n <= 4096; n += 8)
+        {
+            alignas(16) static char buff[4096];
+            std::pmr::monotonic_buffer_resource r(buff, n, std::pmr::null_memory_resource());
+            try
+            {
+                f(&r);
+            }
+            catch (const std::bad_alloc &)
+            {
+                ++thrown;
+            }
+        }
+        return thrown;
+    }
+
+    void testBoundedResource()
+    {
+        const char *end = document + strlen(document);
+        Value source = parseJson(document, end);
+
+        CHECK(exhaust([](std::pmr::memory_resource *r) {
+                  for (int i = 0; i < 8; ++i)
+                  {
+                      Value o = Value::createObject(r);
+                      Value a = Value::createArray(r);
+                  }
+              }) > 0);
+        CHECK(exhaust([&](std::pmr::memory_resource *r) { parseJson(document, end, r); }) > 0);
+        CHECK(exhaust([&](std::pmr::memory_resource *r) { Value v(source, r); }) > 0);
+        CHECK(exhaust([](std::pmr::memory_resource *r) {
+                  Value::createString("a long string that is allocated in the resource", r);
+              }) > 0);
+        CHECK(exhaust([&](std::pmr::memory_resource *r) {
+                  Value v(r);
+                  v["k"] = "a long string that is allocated in the resource";
+                  v["a"] = source["a"];
+                  v["a"].pack();
+                  v["a"][2] = 1.5;
+                  v["a"].add(5);
+              }) > 0);
+
+        // хватает памяти — всё на месте
+        alignas(16) static char buff[1 << 16];
+        std::pmr::monotonic_buffer_resource r(buff, sizeof(buff), std::pmr::null_memory_resource());
+        Value v = parseJson(document, end, &r);
+        CHECK(v == source && v.resource() == &r);
+    }
+
+    // адрес ресурса выше 48 бит значение запомнить не может: такой ресурс
+    // отвергается до первого обращения к нему
+    void testWideResourceAddress()
+    {
+        auto *wide = (std::pmr::memory_resource *)(uintptr_t)0xff00000000001000ull;
+        auto rejects = [](auto f) {
+            try
+            {
+                f();
+            }
+            catch (const std::invalid_argument &)
+            {
+                return true;
+            }
+            return false;
+        };
+        CHECK(rejects([&] { Value v(wide); }));
+        CHECK(rejects([&] { Value::createObject(wide); }));
+        CHECK(rejects([&] { Value::createArray(wide); }));
+        CHECK(rejects([&] { Value::createString("a long string that is allocated in the resource", wide); }));
+        CHECK(rejects([&] { Value v(Value(1.5), wide); }));
+        CHECK(rejects([&] { parseJson(document, document + strlen(document), wide); }));
+    }
+
+    void testCopyOnWrite()
+    {
+        setCopyOnWrite(true);
+
+        Value a = parseJson("{\"list\":[1,\"two\",3],\"map\":{\"k\":1}}");
+        Value b = a;
+        const Value &ca = a, &cb = b;
+        CHECK(ca.asObject() == cb.asObject());
+
+        // неконстантный доступ отделяет копию, оригинал не меняется
+        b.asObject()->emplace("added", Value(1));
+        CHECK(!a.hasKey("added") && b.hasKey("added"));
+        CHECK(ca.asObject() != cb.asObject());
+
+        Value list = a["list"];
+        list.asArray()->push_back(Value(4));
+        CHECK(a["list"].size() == 3 && list.size() == 4);
+
+        Value map = a["map"];
+        (*map.asObject())["k"] = 2;
+        CHECK(a["map"]["k"].asInt() == 1 && map["k"].asInt() == 2);
+
+        // упакованный массив распаковывается в собственную копию
+        Value packed(std::vector<int>(20, 7));
+        CHECK(packed.pack());
+        Value copy = packed;
+        copy.asArray()->front() = 8;
+        CHECK(packed[0].asInt() == 7 && copy[0].asInt() == 8);
+
+        setCopyOnWrite(false);
+    }
+
+    void testPackArrays()
+    {
+        std::string json = "[";
+        for (int i = 0; i < 100; ++i)
+            json += (i ? "," : "") + std::to_string(i);
+        json += "]";
+
+        // по умолчанию массивы не упаковываются, чтение их не меняет
+        Value v = parseJson(json.c_str());
+        CHECK(!v.isPacked() && !Value(std::vector<int>(20, 7)).isPacked());
+        CHECK(v[5].asInt() == 5);
+
+        setPackArrays(true);
+        Value p = parseJson(json.c_str());
+        CHECK(p.isPacked() && p.packedIntegers()[99] == 99);
+        CHECK(Value(std::vector<double>(20, 0.5)).packedNumbers());
+
+        // константное чтение массив не распаковывает
+        const Value &cp = p;
+        CHECK(cp[5].asInt() == 5 && p.isPacked());
+        CHECK(stringify(p) == json);
+        setPackArrays(false);
+    }
+
+} // namespace
+
+int main()
+{
+    testBoundedResource();
+    testWideResourceAddress();
+    testCopyOnWrite();
+    testPackArrays();
+
+    if (fails)
+        printf("%d checks failed\n", fails);
+    return fails != 0;
+}